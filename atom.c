@@ -4,6 +4,47 @@
 #include "vasm.h"
 
 
+#ifdef OPERAND_CLASS
+/* Operands which were already parsed for another mnemonic with the same
+   operand class are copied from this cache and only checked against the
+   new type's requirements. */
+#define MAXOPCLASSES 4
+static struct opcache {
+  int cls;
+  operand op;
+} opcache[MAX_OPERANDS][MAXOPCLASSES];
+static int opcache_cnt[MAX_OPERANDS];
+
+static int parse_cached_operand(char *p,int len,operand *op,int type,int k)
+{
+  struct opcache *c = opcache[k];
+  int cls = OPERAND_CLASS(type);
+  symbol *lastsym = first_symbol;
+  int i,rc;
+
+  for (i=0; i<opcache_cnt[k]; i++) {
+    if (c[i].cls == cls) {
+      *op = c[i].op;
+      return MATCH_OPERAND(op,type);
+    }
+  }
+
+  rc = PARSE_OPERAND_ONLY(p,len,op,type);
+  if (rc != PO_MATCH)
+    return rc;
+
+  /* Do not cache operands which created new symbols, because they are
+     removed again by restore_symbols(), when the mnemonic doesn't match. */
+  if (first_symbol==lastsym && i<MAXOPCLASSES) {
+    c[i].cls = cls;
+    c[i].op = *op;
+    opcache_cnt[k]++;
+  }
+  return MATCH_OPERAND(op,type);
+}
+#endif
+
+
 /* searches mnemonic list and tries to parse (via the cpu module)
    the operands according to the mnemonic requirements; returns an
    instruction or 0 */
@@ -24,6 +65,9 @@ instruction *new_inst(const char *inst,int len,
   /* reset operands to allow the cpu-backend to parse them only once */
   memset(ops,0,sizeof(ops));
 #endif
+#ifdef OPERAND_CLASS
+  memset(opcache_cnt,0,sizeof(opcache_cnt));
+#endif
 
   if (find_namelen_nc(mnemohash,inst,len,&data)) {
     i = data.idx;
@@ -66,11 +110,17 @@ instruction *new_inst(const char *inst,int len,
             break;
           }
 
+#ifdef OPERAND_CLASS
+          rc = parse_cached_operand(op[k],op_len[k],&ops[j],
+                                    mnemo->operand_type[j],k);
+#else
           rc = parse_operand(op[k],op_len[k],&ops[j],mnemo->operand_type[j]);
+#endif
 
           if (rc == PO_CORRUPT) {
             /* operand has errors and will never match */
             restore_symbols();
+            commit_symbols();
             return 0;
           }
           if (rc == PO_NOMATCH)
@@ -117,12 +167,16 @@ instruction *new_inst(const char *inst,int len,
       for(; j<MAX_OPERANDS; j++)
         new->op[j] = NULL;
 
+      commit_symbols();
 #endif /* MAX_OPERANDS!=0 */
 
       new->code = i;
       return new;
     }
     while (i<mnemonic_cnt && mnemonics[i].name==mnemo->name);
+#if MAX_OPERANDS!=0
+    commit_symbols();
+#endif
   }
 
   switch (inst_found) {
@@ -750,3 +804,74 @@ atom *new_nlist_atom(const char *name,int type,int other,int desc,expr *value)
   new->content.nlist->value = value;
   return new;
 }
+
+
+symbol *sec_label_ref(expr *exp,section *sec)
+/* return label, when the expression is a plain reference to a label in sec */
+{
+  if (exp!=NULL && exp->type==SYM && exp->c.sym->type==LABSYM &&
+      exp->c.sym->sec==sec && !(exp->c.sym->flags & VASMINTERN))
+    return exp->c.sym;
+  return NULL;
+}
+
+
+hashtable *new_label_atoms(section *sec)
+/* map the name of each label in sec to the first atom following it */
+{
+  hashtable *ht;
+  hashdata data;
+  size_t n;
+  atom *a,*p;
+
+  for (n=0,a=sec->first; a!=NULL; a=a->next) {
+    if (a->type == LABEL)
+      n++;
+  }
+  ht = new_hashtable(n>0x10 ? n : 0x10);
+  for (a=sec->first; a!=NULL; a=a->next) {
+    if (a->type == LABEL) {
+      for (p=a->next; p!=NULL && (p->type==LABEL || p->type==LINE);
+           p=p->next);
+      data.ptr = p;
+      add_hashentry(ht,a->content.label->name,data);
+    }
+  }
+  return ht;
+}
+
+
+void free_label_atoms(hashtable *ht)
+{
+  hashentry *e,*next;
+  size_t i;
+
+  for (i=0; i<ht->size; i++) {
+    for (e=ht->entries[i]; e!=NULL; e=next) {
+      next = e->next;
+      myfree(e);
+    }
+  }
+  myfree(ht->entries);
+  myfree(ht);
+}
+
+
+symbol *thread_label(hashtable *labelatoms,symbol *lab,section *sec,
+                     symbol *(*jump_label)(atom *,section *))
+/* Follow the chain of unconditional jumps starting at label lab, as
+   recognized by the backend's jump_label(), and return the final
+   destination. Returns lab, when there is no jump at lab. */
+{
+  hashdata data;
+  symbol *dest,*next;
+  int hops;
+
+  for (hops=0,dest=lab; hops<MAX_THREAD_HOPS; hops++) {
+    if (!find_name(labelatoms,dest->name,&data) ||
+        (next = jump_label(data.ptr,sec))==NULL || next==dest)
+      break;
+    dest = next;
+  }
+  return dest;
+}
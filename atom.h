@@ -145,4 +145,12 @@ atom *new_rorgend_atom(void);
 atom *new_assert_atom(expr *,const char *,const char *);
 atom *new_nlist_atom(const char *,int,int,int,expr *);
 
+/* branch threading support for cpu_end_parse() */
+#define MAX_THREAD_HOPS 16
+symbol *sec_label_ref(expr *,section *);
+hashtable *new_label_atoms(section *);
+void free_label_atoms(hashtable *);
+symbol *thread_label(hashtable *,symbol *,section *,
+                     symbol *(*)(atom *,section *));
+
 #endif
@@ -15,7 +15,7 @@ const char *cpuname = "6502";
 int bytespertaddr = 2;
 
 uint16_t cpu_type = M6502;
-static int auto_mask,branchopt,dp_offset;
+static int auto_mask,branchopt,threadopt,dp_offset;
 static uint16_t dpage;    /* zero/direct page (default 0) - set with SETDP */
 static uint8_t asize = 8; /* Accumulator is 8 bits by default */
 static uint8_t xsize = 8; /* Index registers are 8 bits by default */
@@ -24,6 +24,20 @@ static char lo_c = '<';   /* select low-byte or zero/direct page */
 static char hi_c = '>';   /* select high-byte or full absolute */
 
 static int OC_JMPABS,OC_BRA,OC_FIRSTMV,OC_LASTMV;
+static int last_cycles;   /* cycles of the last instruction evaluated */
+
+/* NMOS 6502 execution cycles for each opcode, including the illegal ones,
+   conditional branches counted as taken, no page-crossing penalties */
+static const uint8_t nmos_cycles[256] = {
+  7,6,0,8,3,3,5,5,3,2,2,2,4,4,6,6, 3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  6,6,0,8,3,3,5,5,4,2,2,2,4,4,6,6, 3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  6,6,0,8,3,3,5,5,3,2,2,2,3,4,6,6, 3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  6,6,0,8,3,3,5,5,4,2,2,2,5,4,6,6, 3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  2,6,2,6,3,3,3,3,2,2,2,2,4,4,4,4, 3,6,0,6,4,4,4,4,2,5,2,5,5,5,5,5,
+  2,6,2,6,3,3,3,3,2,2,2,2,4,4,4,4, 3,5,0,5,4,4,4,4,2,4,2,4,4,4,4,4,
+  2,6,2,8,3,3,5,5,2,2,2,2,4,4,6,6, 3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7,
+  2,6,2,8,3,3,5,5,2,2,2,2,4,4,6,6, 3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7
+};
 
 /* sizes for all operand types - refer to addressing modes enum in cpu.h */
 const uint8_t opsize[NUM_OPTYPES] = {
@@ -620,12 +634,50 @@ static void rangecheck(symbol *base,taddr val,operand *op)
 }
 
 
+static int opcode_cycles(uint8_t oc)
+/* return execution cycles of an opcode, 0 when unknown */
+{
+  if (cpu_type & (CSGCE02|HU6280|M45GS02|WDC65816))
+    return 0;  /* only NMOS 6502 and 65C02 timing known */
+
+  if (cpu_type & M65C02) {
+    switch (oc & 0x0f) {
+      case 0x07:  /* RMB/SMB */
+        return 5;
+      case 0x0f:  /* BBR/BBS */
+        return 6;
+    }
+    switch (oc) {
+      case 0x1a: case 0x3a: case 0x89:
+        return 2;
+      case 0x5a: case 0x64: case 0x80: case 0xcb: case 0xda: case 0xdb:
+        return 3;
+      case 0x34: case 0x3c: case 0x74: case 0x7a: case 0x9c: case 0xfa:
+        return 4;
+      case 0x04: case 0x12: case 0x14: case 0x32: case 0x52: case 0x72:
+      case 0x92: case 0x9e: case 0xb2: case 0xd2: case 0xf2:
+        return 5;
+      case 0x0c: case 0x1c: case 0x1e: case 0x3e: case 0x5e: case 0x6c:
+      case 0x7c: case 0x7e:
+        return 6;
+    }
+  }
+  return nmos_cycles[oc];
+}
+
+
+int instruction_cycles(instruction *ip)
+{
+  return last_cycles;
+}
+
+
 dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 {
   dblock *db = new_dblock();
   unsigned char *d,oc;
   taddr val;
-  int i;
+  int i,reljmp=0;
 
   optimize_instruction(ip,sec,pc,1);  /* really execute optimizations now */
 
@@ -648,6 +700,7 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
         break;
       case RELJMP:
         oc ^= 0x20;  /* B!cc branch */
+        reljmp = 1;
         break;
     }
   }
@@ -969,6 +1022,11 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
     }
   }
 
+  /* untaken B!cc and JMP, or the opcode's cycles */
+  if (reljmp)
+    last_cycles = opcode_cycles(db->data[0]) ? 2+3 : 0;
+  else
+    last_cycles = opcode_cycles(db->data[0]);
   return db;
 }
 
@@ -1109,6 +1167,83 @@ int cpu_available(int idx)
 }
 
 
+static symbol *local_label(operand *op,section *sec)
+/* return label, when the operand is a plain reference to a label in sec */
+{
+  if (op->flags & (OF_LO|OF_HI|OF_BK|OF_ID))
+    return NULL;
+  return sec_label_ref(op->value,sec);
+}
+
+
+static int is_jump(instruction *ip)
+/* instruction is JMP <abs> or BRA <rel8> */
+{
+  if (ip->op[0]==NULL || ip->op[1]!=NULL)
+    return 0;
+  if (ip->op[0]->type == ABS)
+    return !strcmp(mnemonics[ip->code].name,"jmp");
+  return ip->op[0]->type==REL8 && !strcmp(mnemonics[ip->code].name,"bra");
+}
+
+
+static symbol *jump_label(atom *a,section *sec)
+/* return the destination of a JMP/BRA <label> atom */
+{
+  if (a!=NULL && a->type==INSTRUCTION && is_jump(a->content.inst))
+    return local_label(a->content.inst->op[0],sec);
+  return NULL;
+}
+
+
+void cpu_end_parse(section *sec)
+/* Branch threading: JMP, BRA and B<cc> to a JMP or BRA are redirected to
+   the final destination. 8-bit branches are only threaded together with
+   -opt-branch, which fixes a destination out of range. Then JMP and BRA
+   to the following instruction are deleted. */
+{
+  hashtable *labelatoms;
+  atom *a,*n;
+
+  if (!threadopt)
+    return;
+  labelatoms = new_label_atoms(sec);
+
+  for (a=sec->first; a!=NULL; a=a->next) {
+    if (a->type == INSTRUCTION) {
+      instruction *ip = a->content.inst;
+      operand *op = ip->op[0];
+      symbol *lab,*dest;
+
+      if (op!=NULL && ip->op[1]==NULL && (op->type==REL8 || is_jump(ip)) &&
+          (lab = local_label(op,sec)) != NULL) {
+        if (op->type!=REL8 || branchopt) {
+          dest = thread_label(labelatoms,lab,sec,jump_label);
+          if (dest != lab)
+            op->value = new_sym_expr(dest);
+        }
+        else
+          dest = lab;
+
+        if (is_jump(ip)) {
+          /* delete a jump to the following instruction */
+          for (n=a->next; n!=NULL && (n->type==LABEL || n->type==LINE);
+               n=n->next) {
+            if (n->type==LABEL && n->content.label==dest) {
+              a->type = DATA;
+              a->content.db = new_dblock();
+              a->lastsize = 0;
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+  free_label_atoms(labelatoms);
+}
+
+
 int init_cpu(void)
 {
   hashdata data;
@@ -1152,6 +1287,8 @@ int cpu_args(char *p)
     dp_offset = 1;
   else if (!strcmp(p,"-opt-branch"))
     branchopt = 1;
+  else if (!strcmp(p,"-opt-thread"))
+    threadopt = 1;
   else if (*p!='-' || !set_cpu_type(p+1))
     return 0;
 
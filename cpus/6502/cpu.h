@@ -18,6 +18,12 @@
 typedef int32_t taddr;
 typedef uint32_t utaddr;
 
+/* cpu module works on the parsed sections (branch threading) */
+#define HAVE_CPU_END_PARSE 1
+
+/* cpu module reports execution cycles of an instruction */
+#define HAVE_INSTRUCTION_CYCLES 1
+
 /* we use OPTS atoms for cpu-specific options */
 #define HAVE_CPU_OPTS 1
 typedef struct {
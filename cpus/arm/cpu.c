@@ -42,11 +42,12 @@ static const char *shift_strings[NUM_SHIFTTYPES] = {
   "LSL","LSR","ASR","ROR","RRX","ASL"
 };
 
-static int OC_SWP,OC_NOP;
+static int OC_SWP,OC_NOP,OC_MOVIMM,OC_LTORG;
 static int elfoutput = 0;       /* output will be an ELF object file */
 
 static section *last_section = 0;
 static int last_data_type = -1; /* for mapping symbol generation */
+static struct arm_litpool *open_pools;  /* literals waiting for LTORG */
 #define TYPE_ARM 0
 #define TYPE_THUMB 1
 #define TYPE_DATA 2
@@ -68,6 +69,39 @@ int cpu_available(int idx)
 }
 
 
+static struct arm_litpool *take_pool(section *sec)
+/* remove the open literal pool of a section from the list and return it */
+{
+  struct arm_litpool **lpp,*lp;
+
+  for (lpp=&open_pools; (lp=*lpp)!=NULL; lpp=&lp->next) {
+    if (lp->sec == sec) {
+      *lpp = lp->next;
+      lp->next = NULL;
+      return lp;
+    }
+  }
+  return NULL;
+}
+
+
+static instruction *new_pool_inst(section *sec)
+/* create an LTORG pseudo instruction, which takes over the open pool */
+{
+  instruction *ip = mymalloc(sizeof(instruction));
+  int i;
+
+  ip->code = OC_LTORG;
+  for (i=0; i<MAX_QUALIFIERS; i++)
+    ip->qualifiers[i] = NULL;
+  for (i=0; i<MAX_OPERANDS; i++)
+    ip->op[i] = NULL;
+  init_instruction_ext(&ip->ext);
+  ip->ext.pool = sec!=NULL ? take_pool(sec) : NULL;
+  return ip;
+}
+
+
 char *parse_cpu_special(char *start)
 /* parse cpu-specific directives; return pointer to end of
    cpu-specific text */
@@ -92,6 +126,12 @@ char *parse_cpu_special(char *start)
         inst_alignment = 4;
       return s;
     }
+    else if ((s-name==5 && !strncmp(name,"ltorg",5)) ||
+             (s-name==4 && !strncmp(name,"pool",4))) {
+      /* dump the current literal pool here */
+      add_atom(0,new_inst_atom(new_pool_inst(current_section)));
+      return s;
+    }
   }
   return start;
 }
@@ -353,7 +393,12 @@ int parse_operand(char *p,int len,operand *op,int optype)
       char *q = p;
 
       /* check that this isn't any other valid operand */
-      if (*p=='#' || *p=='[' || *p=='{' || parse_reg(&q)>=0)
+      if (optype==TPCLW && *p=='=') {
+        /* LDR Rd,=expression: load from literal pool */
+        p = skip(p+1);
+        op->flags |= OFL_LITERAL;
+      }
+      else if (*p=='#' || *p=='[' || *p=='{' || parse_reg(&q)>=0)
         return PO_NOMATCH;
       op->value = parse_expr(&p);
     }
@@ -397,7 +442,13 @@ int parse_operand(char *p,int len,operand *op,int optype)
           return PO_NOMATCH;
       }
       else {  /* an expression */
-        if (ISIDSTART(*p) || isdigit((unsigned char)*p) ||
+        if (optype==PCL12 && *p=='=') {
+          /* LDR Rd,=expression: load from literal pool */
+          p = skip(p+1);
+          op->value = parse_expr(&p);
+          op->flags |= OFL_LITERAL;
+        }
+        else if (ISIDSTART(*p) || isdigit((unsigned char)*p) ||
             (!UPDOWNOPER(optype) && (*p=='-' || *p=='+')))
           op->value = parse_expr(&p);
         else
@@ -550,7 +601,7 @@ static void create_mapping_symbol(int type,section *sec,taddr pc)
   if (type<TYPE_ARM || type>TYPE_DATA)
     ierror(0);
   if (elfoutput) {
-    sym = mymalloc(sizeof(symbol));
+    sym = alloc_symbol();
     sym->type = LABSYM;
     sym->flags = types[type];
     sym->name = names[type];
@@ -565,6 +616,59 @@ static void create_mapping_symbol(int type,section *sec,taddr pc)
 }
 
 
+static taddr literal_address(struct arm_literal *lit,taddr pc,taddr here)
+/* Return the address of a literal. As long as the location of its pool
+   is unknown, return 'here', which results in a zero offset. */
+{
+  lit->pc = pc;
+  if (lit->pool->placed)
+    return lit->pool->pc + (lit->idx << 2);
+  return here;
+}
+
+
+static size_t pool_size(struct arm_litpool *lp,taddr pc)
+/* determine the location and size of a literal pool at pc */
+{
+  size_t pad;
+
+  if (lp==NULL || lp->cnt==0)
+    return 0;
+  pad = (4 - (pc & 3)) & 3;  /* literals are 32-bit aligned */
+  lp->pc = pc + pad;
+  lp->placed = 1;
+  return pad + ((size_t)lp->cnt << 2);
+}
+
+
+static void eval_pool(struct arm_litpool *lp,section *sec,taddr pc,
+                      dblock *db)
+/* write all literals of a pool into a dblock, including relocations */
+{
+  if (db->size = pool_size(lp,pc)) {
+    struct arm_literal *lit;
+    size_t offs = lp->pc - pc;
+    unsigned char *d = db->data = mycalloc(db->size);
+
+    for (d+=offs,lit=lp->first; lit!=NULL; lit=lit->next,offs+=4) {
+      taddr val;
+
+      if (!eval_expr(lit->value,&val,sec,lit->pc)) {
+        symbol *base;
+        int btype = find_base(lit->value,&base,sec,lit->pc);
+
+        if (base)
+          add_extnreloc(&db->relocs,base,val,
+                        btype==BASE_PCREL?REL_PC:REL_ABS,0,32,offs);
+        else
+          general_error(38);  /* illegal relocation */
+      }
+      d = setval(arm_be_mode,d,4,val);
+    }
+  }
+}
+
+
 size_t eval_thumb_operands(instruction *ip,section *sec,taddr pc,
                           uint16_t *insn,dblock *db)
 /* evaluate expressions and try to optimize THUMB instruction,
@@ -596,7 +700,9 @@ size_t eval_thumb_operands(instruction *ip,section *sec,taddr pc,
     int btype;
 
     op = *(ip->op[opcnt]);
-    if (!eval_expr(op.value,&val,sec,pc))
+    if (op.flags & OFL_LITERAL)
+      val = literal_address(ip->ext.lit,pc,(pc&~2)+4);
+    else if (!eval_expr(op.value,&val,sec,pc))
       btype = find_base(op.value,&base,sec,pc);
 
     /* do optimizations first */
@@ -765,6 +871,8 @@ size_t eval_thumb_operands(instruction *ip,section *sec,taddr pc,
               else
                 cpu_error(26,4);  /* offset has to be a multiple of 4 */
             }
+            else if (op.flags & OFL_LITERAL)
+              cpu_error(31,(long)val);  /* literal pool out of range */
             else
               cpu_error(25,10,(long)val);  /* immediate offset out of range */
             break;
@@ -1084,7 +1192,9 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
     int btype;
 
     op = *(ip->op[opcnt]);
-    if (!eval_expr(op.value,&val,sec,pc))
+    if (op.flags & OFL_LITERAL)
+      val = literal_address(ip->ext.lit,pc,pc+8);
+    else if (!eval_expr(op.value,&val,sec,pc))
       btype = find_base(op.value,&base,sec,pc);
 
     /* do optimizations first */
@@ -1156,8 +1266,12 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
               }
               else {
                 op.type = NOOP;
-                if (insn)
-                  cpu_error(4,val);  /* PC-relative ldr/str out of range */
+                if (insn) {
+                  if (op.flags & OFL_LITERAL)
+                    cpu_error(31,(long)val);  /* literal pool out of range */
+                  else
+                    cpu_error(4,val);  /* PC-relative ldr/str out of range */
+                }
               }
             }
             break;
@@ -1533,10 +1647,108 @@ size_t eval_arm_operands(instruction *ip,section *sec,taddr pc,
 }
 
 
+static int literal_key(expr *exp,symbol **sym,taddr *offs)
+/* split a literal expression into symbol and constant offset, if possible */
+{
+  *sym = NULL;
+  *offs = 0;
+  if (exp->type==ADD || exp->type==SUB) {
+    if (exp->right->type != NUM)
+      return 0;
+    *offs = exp->type==ADD ? exp->right->c.val : -exp->right->c.val;
+    exp = exp->left;
+  }
+  if (exp->type == NUM) {
+    *offs += exp->c.val;
+    return 1;
+  }
+  if (exp->type==SYM && !(exp->c.sym->flags & VASMINTERN)) {
+    *sym = exp->c.sym;
+    return 1;
+  }
+  return 0;
+}
+
+
+static int same_literal(expr *exp1,expr *exp2)
+{
+  symbol *sym1,*sym2;
+  taddr offs1,offs2;
+
+  return literal_key(exp1,&sym1,&offs1) && literal_key(exp2,&sym2,&offs2) &&
+         sym1==sym2 && offs1==offs2;
+}
+
+
+static void add_literal(instruction *ip,operand *op,section *sec,taddr pc)
+/* Assign a literal pool entry to LDR Rd,=expression. Identical literals
+   share their pool entry. A constant, which fits into an ARM rotated
+   immediate, is loaded by MOV or MVN instead. */
+{
+  mnemonic *mnemo = &mnemonics[ip->code];
+  struct arm_litpool *lp;
+  struct arm_literal *lit;
+  taddr val;
+
+  if (strcmp(mnemo->name,"ldr") ||
+      (!(mnemo->ext.flags & THUMB) && get_addrmode(ip)!=AM_NONE)) {
+    cpu_error(32);  /* literal operand not allowed */
+    op->flags &= ~OFL_LITERAL;
+    return;
+  }
+
+  if (!(mnemo->ext.flags & THUMB) && eval_expr(op->value,&val,sec,pc) &&
+      (rotated_immediate(val)!=ROTFAIL || rotated_immediate(~val)!=ROTFAIL)) {
+    /* MOV Rd,#val or MVN Rd,#~val */
+    ip->code = OC_MOVIMM;
+    op->type = IMROT;
+    op->flags = 0;
+    return;
+  }
+
+  for (lp=open_pools; lp!=NULL; lp=lp->next) {
+    if (lp->sec == sec)
+      break;
+  }
+  if (lp == NULL) {
+    lp = mycalloc(sizeof(struct arm_litpool));
+    lp->sec = sec;
+    lp->next = open_pools;
+    open_pools = lp;
+  }
+
+  for (lit=lp->first; lit!=NULL; lit=lit->next) {
+    if (same_literal(lit->value,op->value))
+      break;
+  }
+  if (lit == NULL) {
+    lit = mymalloc(sizeof(struct arm_literal));
+    lit->next = NULL;
+    lit->pool = lp;
+    lit->value = op->value;
+    lit->pc = pc;
+    lit->idx = lp->cnt++;
+    if (lp->last)
+      lp->last->next = lit;
+    else
+      lp->first = lit;
+    lp->last = lit;
+  }
+  ip->ext.lit = lit;
+}
+
+
 size_t instruction_size(instruction *ip,section *sec,taddr pc)
 /* Calculate the size of the current instruction; must be identical
    to the data created by eval_instruction. */
 {
+  if (mnemonics[ip->code].ext.flags & LITPOOL)
+    return pool_size(ip->ext.pool,pc);
+
+  if (ip->ext.lit==NULL && ip->op[1]!=NULL &&
+      (ip->op[1]->flags & OFL_LITERAL))
+    add_literal(ip,ip->op[1],sec,pc);  /* first call, when adding the atom */
+
   if (mnemonics[ip->code].ext.flags & THUMB)
     return eval_thumb_operands(ip,sec,pc,NULL,NULL);
 
@@ -1556,6 +1768,13 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
     last_section = sec;
     last_data_type = -1;
   }
+
+  if (mnemonics[ip->code].ext.flags & LITPOOL) {
+    eval_pool(ip->ext.pool,sec,pc,db);
+    if (db->size && last_data_type!=TYPE_DATA)
+      create_mapping_symbol(TYPE_DATA,sec,pc);
+    return db;
+  }
   inst_type = (mnemonics[ip->code].ext.flags & THUMB) ? TYPE_THUMB : TYPE_ARM;
 
   if (inst_type == TYPE_THUMB) {
@@ -1659,6 +1878,12 @@ int init_cpu(void)
       OC_SWP = i;
     else if (!strcmp(mnemonics[i].name,"nop"))
       OC_NOP = i;
+    else if (!strcmp(mnemonics[i].name,"ltorg"))
+      OC_LTORG = i;
+    else if (!strcmp(mnemonics[i].name,"mov") &&
+             mnemonics[i].operand_type[1]==IMROT &&
+             mnemonics[i].operand_type[2]==0)
+      OC_MOVIMM = i;
   }
 
   if (!strcmp(output_format,"elf"))
@@ -1699,6 +1924,34 @@ int init_cpu(void)
 }
 
 
+void init_instruction_ext(instruction_ext *ext)
+{
+  ext->lit = NULL;
+  ext->pool = NULL;
+}
+
+
+void cpu_end_parse(section *sec)
+/* dump a remaining literal pool at the end of its section */
+{
+  struct arm_litpool *lp;
+
+  for (lp=open_pools; lp!=NULL; lp=lp->next) {
+    if (lp->sec == sec) {
+      atom *last = sec->last;
+      atom *a = new_inst_atom(new_pool_inst(sec));
+
+      add_atom(sec,a);
+      if (last != NULL) {
+        a->src = last->src;
+        a->line = last->line;
+      }
+      break;
+    }
+  }
+}
+
+
 int cpu_args(char *p)
 {
   if (!strncmp(p,"-m",2)) {
@@ -49,6 +49,38 @@ typedef struct {
 #define OFL_UP          (0x0010)  /* set up-flag, add offset to base */
 #define OFL_SPSR        (0x0020)  /* 1:SPSR, 0:CPSR */
 #define OFL_FORCE       (0x0040)  /* LDM/STM PSR & force user bit */
+#define OFL_LITERAL     (0x0080)  /* =expression, loaded from literal pool */
+
+
+/* instruction extension */
+#define HAVE_INSTRUCTION_EXTENSION 1
+
+typedef struct {
+  struct arm_literal *lit;    /* pool entry of LDR Rd,=expression */
+  struct arm_litpool *pool;   /* literals dumped by LTORG */
+} instruction_ext;
+
+/* literal pool entry */
+struct arm_literal {
+  struct arm_literal *next;
+  struct arm_litpool *pool;
+  expr *value;
+  taddr pc;                   /* pc of the referencing instruction */
+  int idx;                    /* index of the 32-bit word in its pool */
+};
+
+/* literal pool, collected per section until LTORG or end of section */
+struct arm_litpool {
+  struct arm_litpool *next;   /* next open pool */
+  section *sec;
+  struct arm_literal *first,*last;
+  int cnt;
+  int placed;                 /* pc of the pool is known */
+  taddr pc;                   /* address of the first literal */
+};
+
+/* cpu module completes all sections after parsing */
+#define HAVE_CPU_END_PARSE 1
 
 
 /* operand types - WARNING: the order is important! See defines below. */
@@ -159,6 +191,7 @@ typedef struct {
 #define NOPCWB    (0x00000040)  /* R15 is not allowed in Write-Back mode */
 #define SETCC     (0x00000100)  /* instruction supports S-bit */
 #define SETPSR    (0x00000200)  /* instruction supports P-bit */
+#define LITPOOL   (0x00000400)  /* pseudo instruction for a literal pool */
 #define THUMB     (0x10000000)  /* THUMB instruction */
 
 
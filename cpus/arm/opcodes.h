@@ -104,6 +104,7 @@
     "lsl",  {TRG02,TRG05},                        {0x4080,AA4TUP,THUMB},
     "lsr",  {TRG02,TRG05,TUIM5},                  {0x0800,AA4TUP,THUMB},
     "lsr",  {TRG02,TRG05},                        {0x40c0,AA4TUP,THUMB},
+  "ltorg",  {0},                                  {0x00000000,AAANY,LITPOOL},
   "mcr",    {REG11,CPOP3,REG15,REG19,REG03},      {0x0e000010,AA2UP,0},
   "mcr",    {REG11,CPOP3,REG15,REG19,REG03,CPTYP},{0x0e000010,AA2UP,0},
   "mov",    {REG15,IMROT},                        {0x03a00000,AAANY,SETCC},
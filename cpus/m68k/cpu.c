@@ -60,6 +60,8 @@ static unsigned char opt_pc = 1;      /* <label> -> (<label>,PC) */
 static unsigned char opt_pc080;       /* dest.label -> (<label>,PC) (Apollo) */
 static unsigned char opt_bra = 1;     /* B<cc>.L -> B<cc>.W -> B<cc>.B */
 static unsigned char opt_allbra;      /* also optimizes sized branches */
+static unsigned char opt_thread;      /* B<cc> to BRA/JMP <label> threading */
+static int last_cycles;               /* cycles of last evaluated instruction */
 static unsigned char opt_jbra;        /* JMP/JSR <ext> -> BRA.L/BSR.L (020+) */
 static unsigned char opt_disp = 1;    /* (0,An) -> (An), etc. */
 static unsigned char opt_abs = 1;     /* optimize absolute addresses to 16bit */
@@ -225,6 +227,7 @@ void init_instruction_ext(instruction_ext *ixp)
   ixp->un.real.flags = 0;
   ixp->un.real.last_size = -1;
   ixp->un.real.orig_ext = -1;
+  ixp->un.real.cache = NULL;
 }
 
 
@@ -278,6 +281,9 @@ int m68k_data_operand(int bits)
 }
 
 
+static unsigned char opclass[sizeof(optypes)/sizeof(optypes[0])];
+
+
 int m68k_available(int idx)
 /* Check if mnemonic is available for selected cpu_type. */
 {
@@ -1599,12 +1605,14 @@ static int base_disp_and_ext(operand *op,char **p)
 }
 
 
-int parse_operand(char *p,int len,operand *op,int required)
+int m68k_parse_operand(char *p,int len,operand *op,int required)
+/* Parse an operand for the given type without checking the addressing mode
+   against its requirements. Returns PO_MATCH or PO_CORRUPT. The result only
+   depends on the operand's parse class, see m68k_operand_class(). */
 {
   uint16_t reqmode = optypes[required].modes;
   uint32_t reqflags = optypes[required].flags;
   char *start = p;
-  int i;
 
   op->mode = op->reg = -1;
   op->flags = 0;
@@ -2165,7 +2173,19 @@ int parse_operand(char *p,int len,operand *op,int required)
     }
   }
 
-  /* compare parsed addressing mode against requirements */
+  p = skip(p);
+  if (*p!='\0' && p<(start+len))
+    op->flags |= FL_Garbage;  /* warn about it when the operand matches */
+  return PO_MATCH;
+}
+
+
+int m68k_match_operand(operand *op,int required)
+/* compare parsed addressing mode against requirements */
+{
+  uint16_t reqmode = optypes[required].modes;
+  uint32_t reqflags = optypes[required].flags;
+  int i;
 
   for (i=0; i<16; i++) {
     if (reqmode & (1<<i)) {
@@ -2189,9 +2209,10 @@ int parse_operand(char *p,int len,operand *op,int required)
           }
         }
 
-        p = skip(p);
-        if (*p!='\0' && p<(start+len))
+        if (op->flags & FL_Garbage) {
+          op->flags &= ~FL_Garbage;
           cpu_error(67);  /* trailing garbage in operand */
+        }
         return PO_MATCH;
       }
     }
@@ -2201,6 +2222,40 @@ int parse_operand(char *p,int len,operand *op,int required)
 }
 
 
+int parse_operand(char *p,int len,operand *op,int required)
+{
+  int rc = m68k_parse_operand(p,len,op,required);
+
+  return rc==PO_MATCH ? m68k_match_operand(op,required) : rc;
+}
+
+
+static int same_parse_class(int t1,int t2)
+/* returns true when operands of both types are parsed in the same way */
+{
+  const struct optype *ot1 = &optypes[t1];
+  const struct optype *ot2 = &optypes[t2];
+
+  if ((ot1->flags & OTF_PARSEMASK) != (ot2->flags & OTF_PARSEMASK) ||
+      (ot1->modes & (1<<MODE_An)) != (ot2->modes & (1<<MODE_An)))
+    return 0;
+  if ((ot1->flags & OTF_SRRANGE) &&
+      (ot1->first!=ot2->first || ot1->last!=ot2->last))
+    return 0;
+  if ((ot1->flags & OTF_REGLIST) && (t1==RL)!=(t2==RL))
+    return 0;
+  return 1;
+}
+
+
+int m68k_operand_class(int type)
+/* Return the parse class of an operand type. Operand types of the same
+   class only differ in the addressing modes they accept. */
+{
+  return opclass[type];
+}
+
+
 static void eval_oper(operand *op,section *sec,taddr pc,int final)
 /* evaluate operand expression */
 {
@@ -2832,26 +2887,36 @@ static int aindir_in_list(operand *op,int mfirst,int mlast,taddr list)
 }
 
 
-static unsigned char optimize_instruction(instruction *iplist,section *sec,
-                                          taddr pc,int final)
+static int best_variant(int code,char ext)
+/* See if the next instruction fits as well, and includes the
+   addressing modes of the current one. Following instructions
+   usually have higher CPU requirements.
+   The result is remembered per mnemonic for the current cpu_type. */
 {
-  instruction *ip = iplist;
-  mnemonic *mnemo = &mnemonics[ip->code];
-  char ext = ip->qualifiers[0] ?
-             tolower((unsigned char)ip->qualifiers[0][0]) : '\0';
-  unsigned char ipflags = ip->ext.un.real.flags;
-  signed char lastsize = ip->ext.un.real.last_size;
-  char orig_ext = (char)ip->ext.un.real.orig_ext;
-  uint16_t oc;
-  taddr val=0,cpc;
-  int abs=0,pcrelok=0,i;
+  static struct variant {
+    uint16_t size;  /* size extension the entry was determined for */
+    int code;       /* best variant, or -1 when unknown */
+  } *variants;
+  static uint32_t variants_cpu;
+  mnemonic *mnemo = &mnemonics[code];
+  uint16_t sz = lc_ext_to_size(ext);
+  int i;
 
-  /* See if the next instruction fits as well, and includes the
-     addressing modes of the current one. Following instructions
-     usually have higher CPU requirements. */
-  while (mnemo->name==mnemonics[ip->code+1].name &&
-         (mnemonics[ip->code+1].ext.available & cpu_type) != 0) {
-    mnemonic *nextmn = &mnemonics[ip->code+1];
+  if (variants==NULL || variants_cpu!=cpu_type) {
+    /* (re-)initialize the index for a new cpu_type */
+    if (variants == NULL)
+      variants = mymalloc(mnemonic_cnt*sizeof(struct variant));
+    for (i=0; i<mnemonic_cnt; i++)
+      variants[i].code = -1;
+    variants_cpu = cpu_type;
+  }
+  else if (variants[code].code>=0 && variants[code].size==sz)
+    return variants[code].code;
+
+  variants[code].size = sz;
+  for (i=code; mnemo->name==mnemonics[i+1].name &&
+       (mnemonics[i+1].ext.available & cpu_type) != 0; i++) {
+    mnemonic *nextmn = &mnemonics[i+1];
     uint16_t nextsize = nextmn->ext.size;
 
     /* first check if next instruction supports current size extension */
@@ -2859,14 +2924,32 @@ static unsigned char optimize_instruction(instruction *iplist,section *sec,
         (nextsize&SIZE_MASK) != SIZE_UNSIZED) {
       if ((nextsize&S_CFCHECK) && (cpu_type&mcf))
         nextsize &= ~(SIZE_BYTE|SIZE_WORD);  /* ColdFire */
-      if ((nextsize & lc_ext_to_size(ext)) == 0)
+      if ((nextsize & sz) == 0)
         break;  /* size not supported */
     }
     if (!optypes_subset(mnemo,nextmn) ||
         S_OPCODE_SIZE(nextmn->ext.size) > S_OPCODE_SIZE(mnemo->ext.size))
       break;  /* not all operand types supported or instruction is bigger */
-    ip->code++;
   }
+  return variants[code].code = i;
+}
+
+
+static unsigned char optimize_instruction(instruction *iplist,section *sec,
+                                          taddr pc,int final)
+{
+  instruction *ip = iplist;
+  mnemonic *mnemo = &mnemonics[ip->code];
+  char ext = ip->qualifiers[0] ?
+             tolower((unsigned char)ip->qualifiers[0][0]) : '\0';
+  unsigned char ipflags = ip->ext.un.real.flags;
+  signed char lastsize = ip->ext.un.real.last_size;
+  char orig_ext = (char)ip->ext.un.real.orig_ext;
+  uint16_t oc;
+  taddr val=0,cpc;
+  int abs=0,pcrelok=0,i;
+
+  ip->code = best_variant(ip->code,ext);
   mnemo = &mnemonics[ip->code];
 
   cpc = pc + (S_OPCODE_SIZE(mnemo->ext.size) << 1);
@@ -4299,6 +4382,104 @@ static size_t ip_size(instruction *ip)
 }
 
 
+/* Optimizing an instruction in instruction_size() only depends on the
+   instruction itself, the section and pc, and the evaluated values and
+   base symbols of its operands. When none of them changed since the
+   last pass we can reuse the previous result. */
+struct optval {
+  taddr val;
+  symbol *base;
+  int basetype;
+};
+
+struct optcache {
+  section *sec;
+  uint32_t secflags;
+  taddr pc;
+  int code;
+  char *qual;
+  unsigned char flags;
+  signed char last_size;
+  unsigned char extflags;
+  size_t size;
+  int nvals;
+  struct optval v[1];  /* nvals evaluated operand expressions */
+};
+
+static struct optval optvals[MAX_OPERANDS*2];
+
+
+static int eval_optvals(instruction *ip,section *sec,taddr pc)
+/* evaluate all operand expressions of the real instruction into optvals[],
+   return the number of values */
+{
+  struct optval *v = optvals;
+  int i,j;
+
+  for (i=0; i<MAX_OPERANDS && ip->op[i]!=NULL; i++) {
+    for (j=0; j<2; j++,v++) {
+      expr *exp = ip->op[i]->value[j];
+
+      v->val = 0;
+      v->base = NULL;
+      v->basetype = BASE_OK;
+      if (type_of_expr(exp) == NUM) {
+        if (!eval_expr(exp,&v->val,sec,pc))
+          v->basetype = find_base(exp,&v->base,sec,pc);
+      }
+    }
+  }
+  return v - optvals;
+}
+
+
+static struct optcache *check_optcache(instruction *ip,section *sec,
+                                       taddr pc,int nvals)
+/* return the instruction's cached optimization result when still valid */
+{
+  struct optcache *oc = ip->ext.un.real.cache;
+  int i;
+
+  if (oc==NULL || oc->sec!=sec || oc->secflags!=sec->flags ||
+      oc->pc!=pc || oc->code!=ip->code || oc->qual!=ip->qualifiers[0] ||
+      oc->flags!=ip->ext.un.real.flags ||
+      oc->last_size!=ip->ext.un.real.last_size || oc->nvals!=nvals)
+    return NULL;
+
+  for (i=0; i<nvals; i++) {
+    if (oc->v[i].val!=optvals[i].val || oc->v[i].base!=optvals[i].base ||
+        oc->v[i].basetype!=optvals[i].basetype)
+      return NULL;
+  }
+  return oc;
+}
+
+
+static void set_optcache(instruction *ip,section *sec,taddr pc,int nvals,
+                         unsigned char extflags,size_t size)
+{
+  struct optcache *oc = ip->ext.un.real.cache;
+
+  if (oc==NULL || oc->nvals<nvals) {
+    myfree(oc);
+    oc = mymalloc(sizeof(struct optcache) +
+                  (nvals>0 ? nvals-1 : 0) * sizeof(struct optval));
+    ip->ext.un.real.cache = oc;
+  }
+  oc->sec = sec;
+  oc->secflags = sec->flags;
+  oc->pc = pc;
+  oc->code = ip->code;
+  oc->qual = ip->qualifiers[0];
+  oc->flags = ip->ext.un.real.flags;
+  oc->last_size = ip->ext.un.real.last_size;
+  oc->extflags = extflags;
+  oc->size = size;
+  oc->nvals = nvals;
+  memcpy(oc->v,optvals,nvals*sizeof(struct optval));
+}
+
+
 static size_t iplist_size(instruction *ip)
 {
   size_t size = 0;
@@ -4323,6 +4504,7 @@ size_t instruction_size(instruction *realip,section *sec,taddr pc)
   instruction *ip;
   unsigned char extflags;
   uint16_t extsize;
+  int nvals;
 
   /* check if current mnemonic is valid for selected cpu-type */
   while (!(mnemo->ext.available & cpu_type)) {
@@ -4481,6 +4663,21 @@ size_t instruction_size(instruction *realip,section *sec,taddr pc)
     realip->code++;
   }
 
+  /* MOVEM sets _MOVEMREGS/_MOVEMBYTES while optimizing, so don't cache it */
+  if (!final_pass && (mnemonics[realip->code].ext.opcode[0]&0xfbff)!=0x4880) {
+    struct optcache *oc;
+
+    nvals = eval_optvals(realip,sec,pc);
+    if ((oc = check_optcache(realip,sec,pc,nvals)) != NULL) {
+      /* operands didn't change, reuse last result */
+      size = oc->size;
+      extflags = oc->extflags;
+      goto setsize;
+    }
+  }
+  else
+    nvals = -1;
+
   /* do optimizations on a copy of the current instruction */
   ipslot = 0;
   ip = copy_instruction(realip);
@@ -4488,6 +4685,10 @@ size_t instruction_size(instruction *realip,section *sec,taddr pc)
 
   /* and determine current size (from optimized copy) */
   size = iplist_size(ip);
+  if (nvals >= 0)
+    set_optcache(realip,sec,pc,nvals,extflags,size);
+
+setsize:
   if (!(extflags & IFL_RETAINLASTSIZE))
     realip->ext.un.real.last_size = size;  /* remember size for next pass */
 
@@ -5144,6 +5345,258 @@ static uint16_t apollo_bank_prefix(instruction *ip)
 }
 
 
+/* Execution cycles: exact 68000 values, without wait states, or the
+   68020/68030 cache case. Conditional branches and DBcc are counted as
+   taken, multiplications/divisions with their worst case. Shifts by a
+   register count are counted without the shift count. */
+#define CYC(a,b) (c020 ? (b) : (a))
+
+static int ea_cycles(int m,int r,int l,int c020)
+/* effective address calculation/fetch time for mode m, register r */
+{
+  static const uint8_t ea000[12][2] = {
+    {0,0},{0,0},{4,8},{4,8},{6,10},{8,12},{10,14},{8,12},{12,16},{8,12},
+    {10,14},{4,8}
+  };
+  static const uint8_t ea020[12] = {
+    0,0,3,4,3,3,4,3,3,3,4,2
+  };
+  int i = m<7 ? m : 7+(r<=4?r:4);
+
+  return c020 ? ea020[i]+(i==11&&l?2:0) : ea000[i][l!=0];
+}
+
+static int ctl_cycles(int m,int r,const uint8_t *t)
+/* time from a table for the control addressing modes, 0 if illegal */
+{
+  int i = m==2 ? 0 : (m==5 ? 1 : (m==6 ? 2 : (m==7&&r<=3 ? 3+r : -1)));
+
+  return i>=0 ? t[i] : 0;
+}
+
+static int inst_cycles(unsigned char *d,int c020)
+/* return cycles of the instruction encoded at d, 0 when unknown */
+{
+  static const uint8_t jmp000[7] = { 8,10,14,10,12,10,14 };
+  static const uint8_t jsr000[7] = { 16,18,22,18,20,18,22 };
+  static const uint8_t lea000[7] = { 4,8,12,8,12,8,12 };
+  static const uint8_t pea000[7] = { 12,16,20,16,20,16,20 };
+  static const uint8_t cea020[7] = { 2,4,5,2,2,4,5 };
+  uint16_t op = (d[0]<<8) | d[1];
+  int m = (op>>3) & 7;
+  int r = op & 7;
+  int sz = (op>>6) & 3;
+  int l = sz == 2;
+  int imm = m==7 && r==4;
+  int t,n;
+
+  switch (op >> 12) {
+    case 0x0:
+      if (op & 0x0100) {
+        if (m == 1)  /* MOVEP */
+          return (op&0x40) ? CYC(24,17) : CYC(16,11);
+        t = sz;  /* BTST/BCHG/BCLR/BSET Dn,<ea> */
+        if (m == 0)
+          return t ? CYC(t==2?10:8,6) : CYC(6,4);
+        return (t ? CYC(8,6) : CYC(4,4)) + ea_cycles(m,r,0,c020);
+      }
+      if ((op & 0x0f00) == 0x0800) {  /* BTST/BCHG/BCLR/BSET #n,<ea> */
+        t = sz;
+        if (m == 0)
+          return t ? CYC(t==2?14:12,6) : CYC(10,4);
+        return (t ? CYC(12,6) : CYC(8,4)) + ea_cycles(m,r,0,c020);
+      }
+      t = (op>>9) & 7;
+      if (t==4 || t==7 || sz==3)
+        return 0;
+      if (imm)  /* ORI/ANDI/EORI to CCR/SR */
+        return CYC(20,12);
+      if (m == 0)
+        return l ? CYC((t==1||t==6)?14:16,2) : CYC(8,2);
+      if (t == 6)  /* CMPI */
+        return (l ? CYC(12,2) : CYC(8,2)) + ea_cycles(m,r,l,c020);
+      return (l ? CYC(20,4) : CYC(12,4)) + ea_cycles(m,r,l,c020);
+
+    case 0x1:
+    case 0x2:
+    case 0x3:  /* MOVE, MOVEA */
+      l = (op>>12) == 2;
+      t = (op>>6) & 7;
+      n = (op>>9) & 7;
+      if (t==7 && n>1)
+        return 0;
+      if (t <= 1)
+        n = 0;
+      else
+        n = ea_cycles(t,n,l,c020) - (t==4&&!c020 ? 2 : 0);
+      return CYC(4,2) + ea_cycles(m,r,l,c020) + n;
+
+    case 0x4:
+      switch (op) {
+        case 0x4afc: return CYC(34,20);  /* ILLEGAL */
+        case 0x4e70: return CYC(132,518);  /* RESET */
+        case 0x4e71: return CYC(4,2);  /* NOP */
+        case 0x4e72: return CYC(4,8);  /* STOP */
+        case 0x4e73: return CYC(20,20);  /* RTE */
+        case 0x4e75: return CYC(16,10);  /* RTS */
+        case 0x4e76: return CYC(4,2);  /* TRAPV */
+        case 0x4e77: return CYC(20,14);  /* RTR */
+      }
+      if ((op & 0xfff0) == 0x4e40)  /* TRAP */
+        return CYC(34,20);
+      if ((op & 0xfff8) == 0x4e50)  /* LINK */
+        return CYC(16,5);
+      if ((op & 0xfff8) == 0x4e58)  /* UNLK */
+        return CYC(12,6);
+      if ((op & 0xfff0) == 0x4e60)  /* MOVE USP */
+        return CYC(4,4);
+      if ((op & 0xffc0) == 0x4ec0)  /* JMP */
+        return c020 ? 4+ctl_cycles(m,r,cea020) : ctl_cycles(m,r,jmp000);
+      if ((op & 0xffc0) == 0x4e80)  /* JSR */
+        return c020 ? 5+ctl_cycles(m,r,cea020) : ctl_cycles(m,r,jsr000);
+      if ((op & 0xf1c0) == 0x41c0)  /* LEA */
+        return c020 ? 2+ctl_cycles(m,r,cea020) : ctl_cycles(m,r,lea000);
+      if ((op & 0xf1c0) == 0x4180)  /* CHK.W */
+        return CYC(10,8) + ea_cycles(m,r,0,c020);
+      if ((op & 0xfff8) == 0x4840)  /* SWAP */
+        return CYC(4,4);
+      if ((op & 0xffc0) == 0x4840)  /* PEA */
+        return m>=2 ? (c020 ? 5+ctl_cycles(m,r,cea020) :
+                              ctl_cycles(m,r,pea000)) : 0;
+      if ((op & 0xfff8) == 0x49c0)  /* EXTB */
+        return c020 ? 4 : 0;
+      if ((op & 0xfeb8) == 0x4880)  /* EXT */
+        return CYC(4,4);
+      if ((op & 0xfff8) == 0x4808)  /* LINK.L */
+        return c020 ? 6 : 0;
+      if ((op & 0xfb80) == 0x4880) {  /* MOVEM */
+        uint16_t mask = (d[2]<<8) | d[3];
+
+        for (n=0; mask; mask&=mask-1)
+          n++;
+        if (c020)
+          return ((op&0x400) ? 8+4*n : 4+3*n) + ctl_cycles(m,r,cea020);
+        n *= (op&0x40) ? 8 : 4;
+        return ((op&0x400) ? 12 : 8) + n +
+               (m>=5 ? ea_cycles(m,r,0,0)-4 : 0);
+      }
+      if ((op & 0xffc0) == 0x40c0)  /* MOVE from SR */
+        return m ? CYC(8,8)+ea_cycles(m,r,0,c020) : CYC(6,4);
+      if ((op & 0xffc0) == 0x42c0)  /* MOVE from CCR */
+        return c020 ? (m ? 8 : 4)+ea_cycles(m,r,0,c020) : 0;
+      if ((op & 0xffc0) == 0x44c0)  /* MOVE to CCR */
+        return CYC(12,4) + ea_cycles(m,r,0,c020);
+      if ((op & 0xffc0) == 0x46c0)  /* MOVE to SR */
+        return CYC(12,8) + ea_cycles(m,r,0,c020);
+      if ((op & 0xffc0) == 0x4800)  /* NBCD */
+        return m ? CYC(8,8)+ea_cycles(m,r,0,c020) : CYC(6,6);
+      if ((op & 0xffc0) == 0x4ac0)  /* TAS */
+        return m ? CYC(14,12)+ea_cycles(m,r,0,c020) : CYC(4,4);
+      if ((op & 0xff00) == 0x4a00)  /* TST */
+        return CYC(4,2) + ea_cycles(m,r,l,c020);
+      if ((op & 0xf900) == 0x4000 && sz != 3) {  /* NEGX, CLR, NEG, NOT */
+        if (m == 0)
+          return l ? CYC(6,2) : CYC(4,2);
+        return (l ? CYC(12,4) : CYC(8,4)) + ea_cycles(m,r,l,c020);
+      }
+      if ((op & 0xff80) == 0x4c00 && c020)  /* MULx.L, DIVx.L */
+        return ((op&0x40) ? 90 : 44) + ea_cycles(m,r,1,1);
+      return 0;
+
+    case 0x5:
+      if ((op & 0xf0f8) == 0x50c8)  /* DBcc */
+        return CYC(10,6);
+      if (sz == 3) {  /* Scc */
+        if (m==7 && r>1)
+          return 0;
+        return m ? CYC(8,6)+ea_cycles(m,r,0,c020) : CYC(6,4);
+      }
+      if (m == 0)  /* ADDQ, SUBQ */
+        return l ? CYC(8,2) : CYC(4,2);
+      if (m == 1)
+        return CYC(8,2);
+      return (l ? CYC(12,4) : CYC(8,4)) + ea_cycles(m,r,l,c020);
+
+    case 0x6:
+      return ((op>>8)&15)==1 ? CYC(18,7) : CYC(10,6);  /* BSR, Bcc */
+
+    case 0x7:
+      return (op & 0x100) ? 0 : CYC(4,2);  /* MOVEQ */
+
+    case 0x8:
+    case 0xc:
+      if ((op & 0xf0c0) == 0x80c0)  /* DIVU, DIVS */
+        return ((op&0x100) ? CYC(158,56) : CYC(140,44)) +
+               ea_cycles(m,r,0,c020);
+      if ((op & 0xf0c0) == 0xc0c0)  /* MULU, MULS */
+        return ((op&0x100) ? CYC(70,28) : CYC(70,27)) +
+               ea_cycles(m,r,0,c020);
+      if ((op & 0x1f0) == 0x100)  /* SBCD, ABCD */
+        return (op&8) ? CYC(18,14) : CYC(6,4);
+      if ((op & 0xf1f8)==0xc140 || (op & 0xf1f8)==0xc148 ||
+          (op & 0xf1f8)==0xc188)  /* EXG */
+        return CYC(6,2);
+      if ((op & 0x130) == 0x100 && m <= 1)  /* PACK, UNPK */
+        return 0;
+      break;  /* OR, AND */
+
+    case 0x9:
+    case 0xd:
+      if (sz == 3) {  /* SUBA, ADDA */
+        l = (op & 0x100) != 0;
+        return (l && !(m<=1 || imm) ? CYC(6,2) : CYC(8,2)) +
+               ea_cycles(m,r,l,c020);
+      }
+      if ((op & 0x130) == 0x100 && m <= 1) {  /* SUBX, ADDX */
+        if (m)
+          return l ? CYC(30,10) : CYC(18,10);
+        return l ? CYC(8,2) : CYC(4,2);
+      }
+      break;  /* SUB, ADD */
+
+    case 0xb:
+      if (sz == 3)  /* CMPA */
+        return CYC(6,4) + ea_cycles(m,r,(op&0x100)!=0,c020);
+      if (op & 0x100) {
+        if (m == 1)  /* CMPM */
+          return l ? CYC(20,10) : CYC(12,10);
+        if (m == 0)  /* EOR */
+          return l ? CYC(8,2) : CYC(4,2);
+        return (l ? CYC(12,4) : CYC(8,4)) + ea_cycles(m,r,l,c020);
+      }
+      return (l ? CYC(6,2) : CYC(4,2)) + ea_cycles(m,r,l,c020);  /* CMP */
+
+    case 0xe:
+      if (sz == 3) {
+        if (op & 0x800)
+          return 0;  /* bitfield instructions */
+        return CYC(8,5) + ea_cycles(m,r,0,c020);  /* memory shifts */
+      }
+      if (c020) {
+        t = (op>>3) & 3;
+        return t==1 ? 4 : (t==2 ? 12 : (t==0 && !(op&0x100) ? 6 : 8));
+      }
+      n = (op & 0x20) ? 0 : (((op>>9)&7) ? (op>>9)&7 : 8);
+      return (l ? 8 : 6) + 2*n;
+
+    default:
+      return 0;
+  }
+
+  /* OR, AND, SUB, ADD */
+  if (op & 0x100)
+    return (l ? CYC(12,4) : CYC(8,4)) + ea_cycles(m,r,l,c020);
+  return (l ? ((m<=1 || imm) ? CYC(8,2) : CYC(6,2)) : CYC(4,2)) +
+         ea_cycles(m,r,l,c020);
+}
+
+
+int instruction_cycles(instruction *ip)
+{
+  return last_cycles>0 ? last_cycles : 0;
+}
+
+
 dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 /* Convert an instruction into a DATA atom, including relocations
    if necessary. */
@@ -5153,11 +5606,17 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
   signed char lastsize = ip->ext.un.real.last_size;
   instruction *realip = ip;
   int oldtypechk = typechk;
+  uint32_t c020;
   uint8_t *d;
 
   if (ipflags & IFL_NOTYPECHK)
     typechk = 0;
 
+  /* execution cycles are only known for 68000 and 68020/68030 */
+  c020 = cpu_type & (m68k|cpu32|mcf|apollo);
+  last_cycles = (c020==m68000 || !(c020 & ~(m68020|m68030))) ? 0 : -1;
+  c020 = c020 != m68000;
+
   /* really execute optimizations now */
   ipslot = 0;
   optimize_instruction(ip,sec,pc,1);
@@ -5451,6 +5910,11 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
         pc += newd - d;
         d = newd;
       }
+
+      if (last_cycles >= 0) {
+        i = inst_cycles(dbstart,c020);
+        last_cycles = i ? last_cycles+i : -1;
+      }
     }
   }
   while ((ip = ip->ext.un.copy.next) != NULL);
@@ -5577,6 +6041,74 @@ dblock *eval_data(operand *op,size_t bitsize,section *sec,taddr pc)
 }
 
 
+static symbol *jump_label(atom *a,section *sec)
+/* return the destination of an unconditional BRA or JMP <label> atom */
+{
+  if (a!=NULL && a->type==INSTRUCTION) {
+    instruction *ip = a->content.inst;
+    uint16_t oc = mnemonics[ip->code].ext.opcode[0];
+    operand *op = ip->op[0];
+
+    if (oc==0x6000 || (oc==0x4ec0 && op->mode==MODE_Extended &&
+                       (op->reg==REG_AbsLong || op->reg==REG_PC16Disp)))
+      return sec_label_ref(op->value[0],sec);
+  }
+  return NULL;
+}
+
+
+void cpu_end_parse(section *sec)
+/* Branch threading: a branch to an unconditional BRA or JMP is redirected
+   to its final destination. Branches to the following instruction are
+   deleted by optimize_instruction() later. */
+{
+  int bra=opt_bra,noopt=no_opt,warn=warn_opts;
+  hashtable *labelatoms;
+  atom *a;
+
+  if (!opt_thread)
+    return;
+  labelatoms = new_label_atoms(sec);
+
+  for (a=sec->first; a!=NULL; a=a->next) {
+    if (a->type == OPTS) {
+      /* track the options which decide about branch optimization,
+         without changing the current option state */
+      optcmd *oc = (optcmd *)a->content.opts;
+
+      if (oc->cmd>OCMD_NOOPT && oc->cmd<OCMD_OPTWARN && oc->arg!=0)
+        noopt = 0;
+      switch (oc->cmd) {
+        case OCMD_NOOPT: noopt=oc->arg; break;
+        case OCMD_OPTBRA: bra=oc->arg; break;
+        case OCMD_OPTWARN: warn=oc->arg; break;
+      }
+    }
+
+    else if (a->type == INSTRUCTION) {
+      instruction *ip = a->content.inst;
+      symbol *lab,*dest;
+
+      if ((mnemonics[ip->code].ext.opcode[0] & 0xf000) != 0x6000 ||
+          noopt || !bra || !((ip->ext.un.real.flags&IFL_UNSIZED) || opt_allbra) ||
+          (lab = sec_label_ref(ip->op[0]->value[0],sec)) == NULL)
+        continue;
+
+      dest = thread_label(labelatoms,lab,sec,jump_label);
+      if (dest != lab) {
+        ip->op[0]->value[0] = new_sym_expr(dest);
+        if (warn > 1) {
+          if ((cur_src = a->src) != NULL)
+            cur_src->line = a->line;
+          cpu_error(51,"branch threaded");
+        }
+      }
+    }
+  }
+  free_label_atoms(labelatoms);
+}
+
+
 int init_cpu(void)
 {
   int i,j,code_tab_cnt;
@@ -5606,6 +6138,12 @@ int init_cpu(void)
   if (j < code_tab_cnt)
     ierror(0);
 
+  /* assign parse classes to operand types */
+  for (i=0; i<sizeof(opclass)/sizeof(opclass[0]); i++) {
+    for (j=0; j<i && !same_parse_class(i,j); j++);
+    opclass[i] = j<i ? opclass[j] : i;
+  }
+
   /* flag all mnemonics with an unambiguous size extension */
   for (i=0; i<mnemonic_cnt; i++) {
     if (countbits((taddr)mnemonics[i].ext.size & SIZE_MASK) == 1)
@@ -6591,6 +7129,8 @@ nofpu:
     opt_nmovq = !no_opt;
   else if (!strcmp(p,"-opt-brajmp"))
     opt_brajmp = !no_opt;
+  else if (!strcmp(p,"-opt-thread"))
+    opt_thread = !no_opt;
   else if (!strcmp(p,"-opt-allbra"))
     opt_bra = opt_allbra = !no_opt;
   else if (!strcmp(p,"-opt-jbra"))
@@ -30,6 +30,7 @@ typedef struct {
       unsigned char flags;
       signed char last_size;
       signed char orig_ext;
+      struct optcache *cache;  /* result of last optimize_instruction() */
     } real;
     struct {
       struct instruction *next;
@@ -41,6 +42,12 @@ typedef struct {
 #define IFL_NOTYPECHK         4   /* do not check limits of oper. value */
 #define IFL_ANYSIGN           8   /* allow M_val0 signed and unsigned */
 
+/* cpu module works on the parsed sections (branch threading) */
+#define HAVE_CPU_END_PARSE 1
+
+/* cpu module reports execution cycles of an instruction */
+#define HAVE_INSTRUCTION_CYCLES 1
+
 /* we use OPTS atoms for cpu-specific options */
 #define HAVE_CPU_OPTS 1
 typedef struct {
@@ -104,15 +111,18 @@ enum {
 /* returns true when operand type is optional; may init default operand */
 #define OPERAND_OPTIONAL(p,t) m68k_operand_optional(p,t)
 
+/* parse operands only once for all operand types of the same class */
+#define OPERAND_CLASS(t) m68k_operand_class(t)
+#define PARSE_OPERAND_ONLY(p,l,o,t) m68k_parse_operand(p,l,o,t)
+#define MATCH_OPERAND(o,t) m68k_match_operand(o,t)
+
 /* parse cpu-specific directives with label */
 #define PARSE_CPU_LABEL(l,s) parse_cpu_label(l,s)
 
 /* we define one additional, but internal, unary operation, to count 1-bits */
 int ext_unary_eval(int,taddr,taddr *,int);
-int ext_find_base(symbol **,expr *,section *,taddr);
 #define CNTONES (LAST_EXP_TYPE+1)
 #define EXT_UNARY_EVAL(t,v,r,c) ext_unary_eval(t,v,r,c)
-#define EXT_FIND_BASE(b,e,s,p) BASE_ILLEGAL
 
 /* type to store each operand */
 typedef struct {
@@ -146,6 +156,7 @@ typedef struct {
 #define FL_ZBase        0x400   /* ZAn base register specified */
 #define FL_ZIndex       0x800   /* ZRn index register specified */
 #define FL_BaseReg     0x1000   /* BASEREG expression in exp.value[0] */
+#define FL_Garbage     0x2000   /* parser found trailing garbage */
 #define FL_BnReg       0x4000   /* Apollo: Bn register instead of An */
 #define FL_MAC         0x8000   /* ColdFire MAC specific extensions */
 #define FL_Bitfield   0x10000   /* operand uses bf_offset/bf_width */
@@ -290,6 +301,10 @@ struct optype {
 #define OTF_VXRNG4  0x800 /* Apollo AMMX Rn-Rn+3 vector register range */
 #define OTF_OPT    0x1000 /* optional operand */
 #define OTF_DBRA   0x2000 /* DBcc branch is always 16 bits, ignores size */
+/* flags which have an influence on parsing an operand */
+#define OTF_PARSEMASK (OTF_DATA|OTF_FLTIMM|OTF_QUADIMM|OTF_SRRANGE| \
+                       OTF_REGLIST|OTF_MOVCREG|OTF_VXRNG2|OTF_VXRNG4| \
+                       FL_MAC|FL_DoubleReg)
 
 
 /* additional mnemonic data */
@@ -455,4 +470,7 @@ extern int m68k_mid;
 int m68k_available(int);
 int m68k_data_operand(int);
 int m68k_operand_optional(operand *,int);
+int m68k_operand_class(int);
+int m68k_parse_operand(char *,int,operand *,int);
+int m68k_match_operand(operand *,int);
 int parse_cpu_label(char *,char **);
@@ -22,6 +22,7 @@ static int regnames = 1;
 static taddr sdreg = 13;  /* this is default for V.4, PowerOpen = 2 */
 static taddr sd2reg = 2;
 static unsigned char opt_branch = 0;
+static unsigned char *cond_branch;  /* mnemonics with a BD-type operand */
 
 
 
@@ -530,6 +531,27 @@ static void negate_bo_cond(uint32_t *p)
 }
 
 
+static taddr apply_modifier(taddr val,operand *op,
+                            const struct powerpc_operand *ppcop)
+/* execute @l, @h or @ha modifier on val */
+{
+  switch (op->mode) {
+    case OPM_LO:
+      val &= 0xffff;
+      break;
+    case OPM_HI:
+      val = (val>>16) & 0xffff;
+      break;
+    case OPM_HA:
+      val = ((val>>16) + ((val & 0x8000) ? 1 : 0) & 0xffff);
+      break;
+  }
+  if ((ppcop->flags & OPER_SIGNED) && (val & 0x8000))
+    val -= 0x10000;
+  return val;
+}
+
+
 static uint32_t insertcode(uint32_t i,taddr val,
                            const struct powerpc_operand *o)
 {
@@ -603,21 +625,8 @@ size_t eval_operands(instruction *ip,section *sec,taddr pc,
     }
 
     /* execute modifier on val */
-    if (op.mode) {
-      switch (op.mode) {
-        case OPM_LO:
-          val &= 0xffff;
-          break;
-        case OPM_HI:
-          val = (val>>16) & 0xffff;
-          break;
-        case OPM_HA:
-          val = ((val>>16) + ((val & 0x8000) ? 1 : 0) & 0xffff);
-          break;
-      }
-      if ((ppcop->flags & OPER_SIGNED) && (val & 0x8000))
-        val -= 0x10000;
-    }
+    if (op.mode)
+      val = apply_modifier(val,&op,ppcop);
 
     /* do optimizations here: */
 
@@ -685,13 +694,41 @@ size_t eval_operands(instruction *ip,section *sec,taddr pc,
 }
 
 
+static size_t branch_size(instruction *ip,section *sec,taddr pc)
+/* Determine the size of a conditional branch with opt_branch enabled.
+   Only the branch distance is checked, which must be done identically
+   to eval_operands(). */
+{
+  int i;
+
+  for (i=0; i<MAX_OPERANDS && ip->op[i]!=NULL; i++) {
+    operand *op = ip->op[i];
+
+    if (op->type==BD || op->type==BDM || op->type==BDP) {
+      taddr val;
+
+      if (get_reloc_type(op) != REL_PC)
+        break;
+      if (!eval_expr(op->value,&val,sec,pc))
+        val -= pc;
+      if (op->mode)
+        val = apply_modifier(val,op,&powerpc_operands[op->type]);
+      if (val<-0x8000 || val>0x7fff)
+        return 8;  /* will be converted into B<!cc> $+8 ; B */
+      break;
+    }
+  }
+  return 4;
+}
+
+
 size_t instruction_size(instruction *ip,section *sec,taddr pc)
 /* Calculate the size of the current instruction; must be identical
    to the data created by eval_instruction. */
 {
-  /* determine optimized size, when needed */
-  if (opt_branch)
-    return eval_operands(ip,sec,pc,NULL,NULL);
+  /* determine optimized size of conditional branches, when needed */
+  if (opt_branch && cond_branch[ip->code])
+    return branch_size(ip,sec,pc);
 
   /* otherwise an instruction is always 4 bytes */
   return 4;
@@ -836,6 +873,20 @@ static void define_regnames(void)
 
 int init_cpu(void)
 {
+  if (opt_branch) {
+    /* mark the mnemonics which may grow by branch optimization */
+    int i,j;
+
+    cond_branch = mycalloc(mnemonic_cnt);
+    for (i=0; i<mnemonic_cnt; i++) {
+      for (j=0; j<MAX_OPERANDS; j++) {
+        int t = mnemonics[i].operand_type[j];
+
+        if (t==BD || t==BDM || t==BDP)
+          cond_branch[i] = 1;
+      }
+    }
+  }
   if (regnames)
     define_regnames();
   return 1;
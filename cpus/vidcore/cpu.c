@@ -578,59 +578,89 @@ static int chkval(expr *tree,section *sec,taddr pc,int bits,int sgn)
   return 1;
 }
 
-/* replace instruction by one with encoding enc */
-static int replace(int c,int enc)
+/* alternate encodings, which translate() may select */
+enum {
+  ALT_MEMDISP32,ALT_ARITHR32,ALT_ARITHI32,ALT_ADD48,ALT_ARITHI48,
+  ALT_RBRANCH32,ALT_MEM48,ALT_MEM12DISP32,NUM_ALT
+};
+static const int altenc[NUM_ALT]={
+  EN_MEMDISP32,EN_ARITHR32,EN_ARITHI32,EN_ADD48,EN_ARITHI48,
+  EN_RBRANCH32,EN_MEM48,EN_MEM12DISP32
+};
+
+/* variant[i][a]: next entry behind i with the same name and encoding
+   altenc[a], or -1 */
+static short (*variant)[NUM_ALT];
+
+/* replace instruction by one with alternate encoding a */
+static int replace(int c,int a)
 {
-  int i=c+1;
-  while(!strcmp(mnemonics[c].name,mnemonics[i].name)){
-    if(mnemonics[i].ext.encoding==enc){
-      c=i;
-      break;
-    }
-    i++;
+  if(variant[c][a]<0){
+    ierror(0);
+    return c;
   }
-  if(c!=i) ierror(0);  
-  return c;
+  return variant[c][a];
+}
+
+/* expression value may change between passes */
+static int unstable(expr *tree)
+{
+  return tree->type!=NUM;
 }
+
 static int translate(instruction *p,section *sec,taddr pc)
 {
-  int c=p->code,e=mnemonics[c].ext.encoding;
+  int c=p->code,e=mnemonics[c].ext.encoding,stable=1;
   taddr val;
 
+  if(p->ext.trans)
+    return p->ext.trans-1;
+
   if(p->qualifiers[0]){
     /* extend to larger variants if ccs are required */
     if(e==EN_MEMDISP16)
-      c=replace(c,EN_MEMDISP32);
+      c=replace(c,ALT_MEMDISP32);
     if(e==EN_ARITHR16)
-      c=replace(c,EN_ARITHR32);
+      c=replace(c,ALT_ARITHR32);
     if(e==EN_ARITHI16)
-      c=replace(c,EN_ARITHI32);
+      c=replace(c,ALT_ARITHI32);
   }
   if(e==EN_ARITHI32){
     if(p->op[2]){
-      if(!chkval(p->op[2]->offset,sec,pc,6,1)&&(!strcmp("add",mnemonics[c].name)||!strcmp("sub",mnemonics[c].name)))
-	c=replace(c,EN_ADD48);
+      if(unstable(p->op[2]->offset))
+        stable=0;
+      /* only add and sub have a 48-bit variant with three operands */
+      if(!chkval(p->op[2]->offset,sec,pc,6,1)&&variant[c][ALT_ADD48]>=0)
+	c=replace(c,ALT_ADD48);
     }else{
-      if((mnemonics[c].ext.code<32)&&(!chkval(p->op[1]->offset,sec,pc,6,1)))
-	c=replace(c,EN_ARITHI48);
+      if(mnemonics[c].ext.code<32){
+        if(unstable(p->op[1]->offset))
+          stable=0;
+        if(!chkval(p->op[1]->offset,sec,pc,6,1))
+          c=replace(c,ALT_ARITHI48);
+      }
     }
   }
   if(e==EN_ARITHI16){
+    if(unstable(p->op[1]->offset))
+      stable=0;
     if(!chkval(p->op[1]->offset,sec,pc,5,0))
-      c=replace(c,EN_ARITHI48);
+      c=replace(c,ALT_ARITHI48);
   }
   if(e==EN_RBRANCH16){
     symbol *base;
+    stable=0;
     if(find_base(p->op[0]->offset,&base,sec,pc)!=BASE_OK||!LOCREF(base)||base->sec!=sec)
-      c=replace(c,EN_RBRANCH32);
+      c=replace(c,ALT_RBRANCH32);
     else{
       eval_expr(p->op[0]->offset,&val,sec,pc);
       val-=pc;
       if(val>126||val<-128)
-	c=replace(c,EN_RBRANCH32);
+	c=replace(c,ALT_RBRANCH32);
     }
   }
   if(e==EN_ADDCMPB32){
+    stable=0;
     eval_expr(p->op[3]->offset,&val,sec,pc);
     val-=pc;
     if(val>1022||val<-1024)
@@ -639,18 +669,22 @@ static int translate(instruction *p,section *sec,taddr pc)
       c+=4;
   }
   if((e==EN_MEMDISP16||e==EN_MEMDISP32||e==EN_MEM12DISP32||e==EN_MEM16DISP32)){
+    if(unstable(p->op[1]->offset))
+      stable=0;
     if(!eval_expr(p->op[1]->offset,&val,sec,pc)){
-      c=replace(c,EN_MEM48);
+      c=replace(c,ALT_MEM48);
     }else{
       if(e==EN_MEMDISP16&&(val<0||val>54||(val&3))){
 	if(val<=4095&&val>=-4096)
-	  c=replace(c,EN_MEM12DISP32);
+	  c=replace(c,ALT_MEM12DISP32);
 	else
-	  c=replace(c,EN_MEM48);
+	  c=replace(c,ALT_MEM48);
       }
     }
   }
   /* todo */
+  if(stable)
+    p->ext.trans=c+1;
   return c;
 }
 
@@ -1140,9 +1174,31 @@ operand *new_operand(void)
   return new;
 }
 
+void init_instruction_ext(instruction_ext *ext)
+{
+  ext->trans=0;
+}
+
 /* return true, if initialization was successful */
 int init_cpu(void)
 {
+  int i,a;
+
+  /* mnemonics with the same name are grouped, so the variant table can
+     be built from the end */
+  variant=mymalloc(mnemonic_cnt*sizeof(*variant));
+  for(a=0;a<NUM_ALT;a++)
+    variant[mnemonic_cnt-1][a]=-1;
+  for(i=mnemonic_cnt-2;i>=0;i--){
+    for(a=0;a<NUM_ALT;a++){
+      if(strcmp(mnemonics[i].name,mnemonics[i+1].name))
+        variant[i][a]=-1;
+      else if(mnemonics[i+1].ext.encoding==altenc[a])
+        variant[i][a]=i+1;
+      else
+        variant[i][a]=variant[i+1][a];
+    }
+  }
   return 1;
 }
 
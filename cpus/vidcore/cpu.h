@@ -17,6 +17,12 @@ typedef uint32_t utaddr;
 #define BITSPERBYTE 8
 #define VASM_CPU_VC4 1
 
+/* instruction extension */
+#define HAVE_INSTRUCTION_EXTENSION 1
+typedef struct {
+  int trans;  /* translated mnemonic index + 1, when it cannot change */
+} instruction_ext;
+
 /* minimum instruction alignment */
 #define INST_ALIGN 2
 
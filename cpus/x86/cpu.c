@@ -43,6 +43,9 @@ static unsigned char OC_POP_SREG2;
 static unsigned char OC_MOV_ACC_DISP;
 static unsigned char OC_JMP_DISP;
 
+/* index of the next mnemonic with the same name, available for cpu_type */
+static int *next_variant;
+
 /* opcode suffixes */
 static char *b_str = "b";
 static char *w_str = "w";
@@ -539,9 +542,8 @@ static int find_next_mnemonic(instruction *ip)
 /* finds a mnemonic with the same name, which fits the given
    operand types and suffix */
 {
-  const char *inst_name = mnemonics[ip->code].name;
-  int code = ip->code + 1;
-  mnemonic *mnemo = &mnemonics[code];
+  int code = next_variant[ip->code];
+  mnemonic *mnemo;
   uint32_t chksuffix = suffix_flag(ip);
 
   if ((cpudebug & 32) && !(cpudebug & 4)) {
@@ -550,9 +552,11 @@ static int find_next_mnemonic(instruction *ip)
     print_operands(ip,-1);
   }
 
-  while (!strcmp(inst_name,mnemo->name)) {
+  for (; code>=0; code=next_variant[code]) {
     int i,given,allowed,overlap,new_types[MAX_OPERANDS];
 
+    mnemo = &mnemonics[code];
+
     for (i=0; i<MAX_OPERANDS; i++) {
       if (allowed = mnemo->operand_type[i]) {
         if (ip->op[i]) {
@@ -576,14 +580,12 @@ static int find_next_mnemonic(instruction *ip)
     }
 
     if (i == MAX_OPERANDS) {
-      /* all operands match, check suffix and CPU type */
+      /* all operands match, check suffix (CPU type was checked in init) */
       if (cpudebug & 32) {
-        printf("\toperands match, suffixOK=%d, cpuOK=%d\n",
-               (mnemo->ext.opcode_modifier & chksuffix) == 0,
-               (mnemo->ext.available & cpu_type) == mnemo->ext.available);
+        printf("\toperands match, suffixOK=%d\n",
+               (mnemo->ext.opcode_modifier & chksuffix) == 0);
       }
-      if (!(mnemo->ext.opcode_modifier & chksuffix) &&
-          (mnemo->ext.available & cpu_type)==mnemo->ext.available) {
+      if (!(mnemo->ext.opcode_modifier & chksuffix)) {
         for (i=0; i<MAX_OPERANDS; i++) {
           if (ip->op[i]) {
             if (cpudebug & 32) {
@@ -606,10 +608,6 @@ static int find_next_mnemonic(instruction *ip)
         return 1;
       }
     }
-
-    /* try next entry from mnemonics table */
-    mnemo++;
-    code++;
   }
 
   if (cpudebug & 32)
@@ -1766,6 +1764,26 @@ void init_instruction_ext(instruction_ext *ixp)
 }
 
 
+static int pass_sensitive(instruction *ip)
+/* Returns true, when the instruction's size depends on symbols or
+   on the current pc. Otherwise it will never change between passes. */
+{
+  int i;
+
+  if (mnemonics[ip->code].ext.opcode_modifier & (Jmp|JmpByte|JmpDword))
+    return 1;  /* jump distances are always pc-relative */
+  for (i=0; i<MAX_OPERANDS; i++) {
+    if (ip->op[i]) {
+      if (ip->op[i]->value!=NULL && ip->op[i]->value->type>=SYM)
+        return 1;  /* not reduced to a constant by parse_expr() */
+    }
+    else
+      break;
+  }
+  return 0;
+}
+
+
 size_t instruction_size(instruction *realip,section *sec,taddr pc)
 /* Calculate the size of the current instruction; must be identical
    to the data created by eval_instruction. */
@@ -1802,10 +1820,20 @@ size_t instruction_size(instruction *realip,section *sec,taddr pc)
       if (!find_next_mnemonic(realip))
         cpu_error(0);  /* instruction not supported on selected arch. */
     }
+    if (pass_sensitive(realip))
+      realip->ext.flags |= PASS_SENSITIVE;
   }
 
-  /* work on a copy of the current instruction and finalize it */
-  size = finalize_instruction(copy_inst(realip),sec,pc,0);
+  if ((realip->ext.flags & PASS_SENSITIVE) || realip->ext.last_size<0) {
+    /* work on a copy of the current instruction and finalize it */
+    size = finalize_instruction(copy_inst(realip),sec,pc,0);
+  }
+  else {
+    /* only registers and constants: size is known from the first pass */
+    size = realip->ext.last_size;
+    if (cpudebug & 16)
+      printf("%08lx: (%u) %s",(unsigned long)pc,(unsigned)size,mnemo->name);
+  }
 
   if (realip->ext.last_size>=0 && (diff=realip->ext.last_size-(int)size)!=0) {
     if (diff > 0) {
@@ -1910,6 +1938,20 @@ int init_cpu(void)
   if (!(cpu_type & CPU64))
     cpu_type |= CPUNo64;
 
+  /* chain the alternatives of each mnemonic, which are available
+     for the selected CPU, so find_next_mnemonic() can skip the rest */
+  next_variant = mymalloc(mnemonic_cnt*sizeof(int));
+  next_variant[mnemonic_cnt-1] = -1;
+  for (i=mnemonic_cnt-2; i>=0; i--) {
+    if (strcmp(mnemonics[i].name,mnemonics[i+1].name))
+      next_variant[i] = -1;
+    else if ((mnemonics[i+1].ext.available & cpu_type) ==
+             mnemonics[i+1].ext.available)
+      next_variant[i] = i + 1;
+    else
+      next_variant[i] = next_variant[i+1];
+  }
+
   for (i=0; i<mnemonic_cnt; i++) {
     if (!strcmp(mnemonics[i].name,"addr16"))
       OC_ADDR_PREFIX = (unsigned char)mnemonics[i].ext.base_opcode;
@@ -213,6 +213,7 @@ typedef struct {
 #define SUFFIX_CHECKED    0x2   /* suffix assigned and checked */
 #define MODRM_BYTE        0x4   /* needs mod/rm byte */
 #define SIB_BYTE          0x8   /* needs sib byte */
+#define PASS_SENSITIVE    0x10  /* size may change between passes */
 #define NEGOPT            0x40  /* negatively optimized, bytes gained */
 #define POSOPT            0x80  /* positively optimized, bytes gained */
 #define OPTFAILED         (POSOPT|NEGOPT)  /* no longer try to optimize this */
@@ -720,6 +720,8 @@ static int z80asm_compat = 0;
 static int cpu_type = CPU_Z80;
 static int swapixiy = 0;
 static int rcmemu = 0;
+static int opt_branch = 0;
+static int OC_JP, OC_JPCC, OC_JR, OC_JRCC, OC_DJNZ;
 
 /* Variables set by special parsing */
 static int altd_enabled = 0;
@@ -1288,6 +1290,7 @@ void init_instruction_ext(instruction_ext *ext)
     ext->altd = altd_enabled;
     ext->ioi = ioi_enabled;
     ext->ioe = ioe_enabled;
+    ext->longdjnz = 0;
 }
 
 static int parse_rcm_identifier(char **sptr)
@@ -1384,11 +1387,95 @@ char *parse_cpu_special(char *start)
     return start;
 }
 
+static int branch_distance(operand *op, section *sec, taddr pc, taddr *dist)
+{
+    symbol *base;
+    taddr   val;
+
+    /* Only a label from the current section, or an absolute address
+       in an absolute section, has a known distance */
+    if ( eval_expr(op->value, &val, sec, pc) == 0 ) {
+        modifier = 0;
+        if ( find_base(op->value, &base, sec, pc) != BASE_OK ||
+             base->type != LABSYM || base->sec != sec || modifier != 0 ) {
+            return 0;
+        }
+    } else if ( (sec->flags & ABSOLUTE) == 0 ) {
+        return 0;
+    }
+    *dist = val - (pc + 2);
+    return 1;
+}
+
+static void relax_branch(instruction *ip, section *sec, taddr pc)
+{
+    operand *op, *cc = NULL;
+    taddr    dist;
+    int      longbr;
+
+    if ( ip->code == OC_JP || ip->code == OC_JR || ip->code == OC_DJNZ ) {
+        op = ip->op[0];
+    } else if ( ip->code == OC_JPCC || ip->code == OC_JRCC ) {
+        cc = ip->op[0];
+        op = ip->op[1];
+        if ( cc->flags > FLAGS_C )
+            return;    /* Not encodable as jr cc */
+    } else {
+        return;
+    }
+    if ( ip->ext.altd || ip->ext.ioi || ip->ext.ioe ||
+         branch_distance(op, sec, pc, &dist) == 0 ) {
+        return;
+    }
+
+    /* Prefer the long form when the resolver detects oscillation */
+    longbr = dist < -128 || dist > 127 || (sec->flags & RESOLVE_WARN);
+
+    if ( ip->code == OC_DJNZ ) {
+        ip->ext.longdjnz = longbr;
+    } else {
+        if ( cc != NULL )
+            ip->code = longbr ? OC_JPCC : OC_JRCC;
+        else
+            ip->code = longbr ? OC_JP : OC_JR;
+        op->type = longbr ? OP_ABS16 : OP_ABS;
+    }
+}
+
+static dblock *eval_long_djnz(instruction *ip, section *sec, taddr pc)
+{
+    dblock *db = new_dblock();
+    unsigned char *d;
+    symbol *base;
+    taddr   val;
+
+    db->size = 4;
+    d = db->data = mymalloc(db->size);
+    *d++ = 0x05;    /* dec b */
+    *d++ = 0xc2;    /* jp nz,label */
+    if ( eval_expr(ip->op[0]->value, &val, sec, pc) == 0 ) {
+        if ( find_base(ip->op[0]->value, &base, sec, pc) == BASE_OK )
+            add_extnreloc(&db->relocs, base, val, REL_ABS, 0, 16, 2);
+        else
+            general_error(38);  /* illegal relocation */
+    }
+    setval(0, d, 2, val);
+    return db;
+}
+
 size_t instruction_size(instruction *ip, section *sec, taddr pc)
 {
-    mnemonic *opcode = &mnemonics[ip->code];
+    mnemonic *opcode;
     size_t    size;
 
+    /* Relax jr/jp/djnz according to the branch distance */
+    if ( opt_branch ) {
+        relax_branch(ip, sec, pc);
+        if ( ip->ext.longdjnz )
+            return 4;
+    }
+    opcode = &mnemonics[ip->code];
+
     /* Try and find the right opcode as necessary */
     if ( (opcode->ext.cpus & cpu_type)  ) {
         int action = -1;
@@ -1831,7 +1918,7 @@ dblock *eval_data(operand *op,size_t bitsize,section *sec,taddr pc)
 dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 {
     dblock *db;
-    mnemonic *opcode = &mnemonics[ip->code];
+    mnemonic *opcode;
     symbol *base;
     unsigned char *d;
     taddr val = 0;
@@ -1840,6 +1927,10 @@ dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 
 
     size = instruction_size(ip, sec, pc);
+    if ( ip->ext.longdjnz ) {
+        return eval_long_djnz(ip, sec, pc);
+    }
+    opcode = &mnemonics[ip->code];
 
     if ( (opcode->ext.cpus & cpu_type) == 0 ) {
         cpu_error(1, cpuname, opcode->name);
@@ -2234,7 +2325,33 @@ operand *new_operand(void)
 
 int init_cpu(void)
 {
+  int i;
+
   current_pc_char = '$';
+
+  /* jp/jr/djnz variants used for branch relaxation */
+  for (i=0; i<mnemonic_cnt; i++) {
+    if (!strcmp(mnemonics[i].name,"jp")) {
+      if (mnemonics[i].operand_type[0]==OP_FLAGS &&
+          mnemonics[i].operand_type[1]==OP_ABS16)
+        OC_JPCC = i;
+      else if (mnemonics[i].operand_type[0]==OP_ABS16 &&
+               mnemonics[i].ext.opcode==0xc3)
+        OC_JP = i;
+    }
+    else if (!strcmp(mnemonics[i].name,"jr")) {
+      if (mnemonics[i].operand_type[0]==OP_FLAGS)
+        OC_JRCC = i;
+      else if (mnemonics[i].operand_type[0]==OP_ABS)
+        OC_JR = i;
+    }
+    else if (!strcmp(mnemonics[i].name,"djnz"))
+      OC_DJNZ = i;
+  }
+
+  /* no relative jumps on the 8080 */
+  if (cpu_type & (CPU_8080|CPU_80OS))
+    opt_branch = 0;
   return 1;
 }
 
@@ -2274,6 +2391,9 @@ int cpu_args(char *p)
     } else if ( strcmp(p, "-swapixiy") == 0 ) {
         swapixiy = 1;
         return 1;
+    } else if ( strcmp(p, "-opt-branch" ) == 0 ) {
+        opt_branch = 1;
+        return 1;
     } else if ( strcmp(p, "-rcmemu" ) == 0 ) {
         rcmemu = 1;
         return 1;
@@ -47,6 +47,7 @@ typedef struct {
     int  altd;
     int  ioi;
     int  ioe;
+    int  longdjnz;  /* djnz expanded to dec b + jp nz (-opt-branch) */
 } instruction_ext;
 
 /* minimum instruction alignment */
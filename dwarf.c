@@ -144,6 +144,68 @@ static void make_file_lists(struct source_file *first_source)
 }
 
 
+/* The line number program is collected in a growable buffer, which is
+   only turned into a data atom of .debug_line when an address with
+   relocation has to follow, or at the end. */
+static void lbuf_data(struct dwarf_info *dinfo,const void *p,size_t len)
+{
+  if (dinfo->lbuf_len + len > dinfo->lbuf_size) {
+    dinfo->lbuf_size = (dinfo->lbuf_len + len) * 2;
+    dinfo->lbuf = myrealloc(dinfo->lbuf,dinfo->lbuf_size);
+  }
+  memcpy(dinfo->lbuf+dinfo->lbuf_len,p,len);
+  dinfo->lbuf_len += len;
+}
+
+
+static void lbuf_byte(struct dwarf_info *dinfo,unsigned char b)
+{
+  if (dinfo->lbuf_len < dinfo->lbuf_size)
+    dinfo->lbuf[dinfo->lbuf_len++] = b;
+  else
+    lbuf_data(dinfo,&b,1);
+}
+
+
+static void lbuf_leb128(struct dwarf_info *dinfo,utaddr c)
+{
+  unsigned char b;
+
+  do {
+    b = c & 0x7f;
+    if ((c >>= 7) != 0)
+      b |= 0x80;
+    lbuf_byte(dinfo,b);
+  } while (c != 0);
+}
+
+
+static void lbuf_sleb128(struct dwarf_info *dinfo,taddr c)
+{
+  int done = 0;
+  unsigned char b;
+
+  do {
+    b = c & 0x7f;
+    c >>= 7;  /* assumes arithmetic shifts! */
+    if ((c==0 && !(b&0x40)) || (c==-1 && (b&0x40)))
+      done = 1;
+    else
+      b |= 0x80;
+    lbuf_byte(dinfo,b);
+  } while (!done);
+}
+
+
+static void lbuf_flush(struct dwarf_info *dinfo)
+{
+  if (dinfo->lbuf_len) {
+    add_char_atom(dinfo->lsec,dinfo->lbuf,dinfo->lbuf_len);
+    dinfo->lbuf_len = 0;
+  }
+}
+
+
 void dwarf_init(struct dwarf_info *dinfo,
                 struct include_path *first_incpath,
                 struct source_file *first_source)
@@ -154,7 +216,6 @@ void dwarf_init(struct dwarf_info *dinfo,
   section *dsec;
   struct DWinclude *dwinc;
   struct DWfile *dwfil;
-  int i;
 
   if (dinfo->version < 2)
     ierror(0);
@@ -273,25 +334,27 @@ void dwarf_init(struct dwarf_info *dinfo,
   add_data_atom(dsec,1,1,dinfo->opcode_base);
 
   /* define standard opcode lengths */
-  for (i=0; i<sizeof(stdopclengths); i++)
-    add_data_atom(dsec,1,1,stdopclengths[i]);
+  dinfo->lbuf = NULL;
+  dinfo->lbuf_len = dinfo->lbuf_size = 0;
+  lbuf_data(dinfo,stdopclengths,sizeof(stdopclengths));
 
   /* make lists of DWARF directories and files */
   make_file_lists(first_source);
 
   /* list of include directories, CWD-entry (index 0) is not written */
   for (dwinc=first_dwinc; dwinc; dwinc=dwinc->next)
-    add_string_atom(dsec,dwinc->name);
-  add_data_atom(dsec,1,1,0);  /* list is terminated by a 0-byte */
+    lbuf_data(dinfo,dwinc->name,strlen(dwinc->name)+1);
+  lbuf_byte(dinfo,0);  /* list is terminated by a 0-byte */
 
   /* list of file names, with directory-index, last-modif.-time and size */
   for (dwfil=first_dwfil; dwfil; dwfil=dwfil->next) {
-    add_string_atom(dsec,dwfil->name);
-    add_leb128_atom(dsec,dwfil->incidx);
-    add_leb128_atom(dsec,0);  /* time */
-    add_leb128_atom(dsec,0);  /* size */
+    lbuf_data(dinfo,dwfil->name,strlen(dwfil->name)+1);
+    lbuf_leb128(dinfo,dwfil->incidx);
+    lbuf_leb128(dinfo,0);  /* time */
+    lbuf_leb128(dinfo,0);  /* size */
   }
-  add_data_atom(dsec,1,1,0);  /* list is terminated by a 0-byte */
+  lbuf_byte(dinfo,0);  /* list is terminated by a 0-byte */
+  lbuf_flush(dinfo);
 
   /* start of statement program */
   setval(BIGENDIAN,lengthptr,4,dsec->pc-10);
@@ -313,7 +376,9 @@ void dwarf_finish(struct dwarf_info *dinfo)
   }
 
   /* set .debug_line compilation unit size */
+  lbuf_flush(dinfo);
   setval(BIGENDIAN,dinfo->line_length,4,dinfo->lsec->pc-4);
+  myfree(dinfo->lbuf);
 }
 
 
@@ -324,7 +389,8 @@ static void dwarf_set_address(struct dwarf_info *dinfo,symbol *sym)
 
   /* extended opcode to set address for current cpu including relocation */
   opcode[1] = dinfo->addr_len + 1;
-  add_char_atom(dinfo->lsec,opcode,3);
+  lbuf_data(dinfo,opcode,3);
+  lbuf_flush(dinfo);
   a = add_data_atom(dinfo->lsec,dinfo->addr_len,1,sym->pc);
   add_extnreloc(&a->content.db->relocs,sym,sym->pc,REL_ABS,
                 0,dinfo->addr_len*BITSPERBYTE,0);
@@ -354,7 +420,7 @@ void dwarf_end_sequence(struct dwarf_info *dinfo,section *sec)
     atom *a;
 
     dwarf_set_address(dinfo,sym);
-    add_char_atom(dinfo->lsec,opcode,3);
+    lbuf_data(dinfo,opcode,3);
     dinfo->end_sequence = 1;
 
     /* enter section size for this sequence into the address-range table */
@@ -379,6 +445,55 @@ void dwarf_end_sequence(struct dwarf_info *dinfo,section *sec)
 }
 
 
+static void line_entry(struct dwarf_info *dinfo,int instoffs,int lineoffs)
+/* append a new matrix row, advancing address and line by the given offsets,
+   using a single special opcode whenever possible */
+{
+  int spc_op;
+
+  if (instoffs > dinfo->max_pcadvance) {
+    if (instoffs - dinfo->max_pcadvance <= dinfo->max_pcadvance) {
+      /* const_add_pc for up to twice the maximum special opcode advance */
+      lbuf_byte(dinfo,DW_LNS_const_add_pc);
+      instoffs -= dinfo->max_pcadvance;
+    }
+    else {
+      /* advance address by standard opcode */
+      lbuf_byte(dinfo,DW_LNS_advance_pc);
+      lbuf_leb128(dinfo,instoffs);
+      instoffs = 0;
+    }
+  }
+
+  if (lineoffs < dinfo->line_base ||
+      lineoffs >= dinfo->line_base + dinfo->line_range) {
+    /* we have to advance line by standard opcode */
+    lbuf_byte(dinfo,DW_LNS_advance_line);
+    lbuf_sleb128(dinfo,lineoffs);
+    lineoffs = 0;
+  }
+
+  /* construct special opcode for simultaneous inst./pc-advancement */
+  spc_op = instoffs * dinfo->line_range + (lineoffs - dinfo->line_base) +
+           dinfo->opcode_base;
+
+  if (spc_op<0 || spc_op>0xff) {
+    /* not representable as a special opcode, so emit standard opcodes */
+    if (instoffs == dinfo->max_pcadvance)
+      lbuf_byte(dinfo,DW_LNS_const_add_pc);
+    else if (instoffs)
+      ierror(0);
+    if (lineoffs) {
+      lbuf_byte(dinfo,DW_LNS_advance_line);
+      lbuf_sleb128(dinfo,lineoffs);
+    }
+    lbuf_byte(dinfo,DW_LNS_copy);  /* new matrix entry */
+  }
+  else
+    lbuf_byte(dinfo,spc_op);  /* matrix entry by special op */
+}
+
+
 void dwarf_line(struct dwarf_info *dinfo,section *sec,source *src)
 {
   int file,line;
@@ -451,68 +566,23 @@ void dwarf_line(struct dwarf_info *dinfo,section *sec,source *src)
     dwarf_set_address(dinfo,new_tmplabel(sec));
 
     if (file != dinfo->file) {
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_set_file);
-      add_leb128_atom(dinfo->lsec,file);
+      lbuf_byte(dinfo,DW_LNS_set_file);
+      lbuf_leb128(dinfo,file);
       dinfo->file = file;
     }
-    if (line != dinfo->line) {
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_line);
-      add_sleb128_atom(dinfo->lsec,line-dinfo->line);
-      dinfo->line = line;
-    }
-    add_data_atom(dinfo->lsec,1,1,DW_LNS_copy);
+    line_entry(dinfo,0,line-dinfo->line);
+    dinfo->line = line;
   }
   else {
     int lineoffs = line - dinfo->line;
     int instoffs = (sec->pc - dinfo->address) / dinfo->min_inst_len;
-    int spc_op;
 
     if (file != dinfo->file) {
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_set_file);
-      add_leb128_atom(dinfo->lsec,file);
+      lbuf_byte(dinfo,DW_LNS_set_file);
+      lbuf_leb128(dinfo,file);
       dinfo->file = file;
     }
-
-    if (instoffs > dinfo->max_pcadvance) {
-      if (instoffs - dinfo->max_pcadvance <= dinfo->max_pcadvance) {
-        /* const_add_pc for up to twice the maximum special opcode advance */
-        add_data_atom(dinfo->lsec,1,1,DW_LNS_const_add_pc);
-        instoffs -= dinfo->max_pcadvance;
-      }
-      else {
-        /* advance address by standard opcode */
-        add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_pc);
-        add_leb128_atom(dinfo->lsec,instoffs);
-        instoffs = 0;
-      }
-    }
-
-    if (lineoffs < dinfo->line_base ||
-        lineoffs >= dinfo->line_base + dinfo->line_range) {
-      /* we have to advance line by standard opcode */
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_line);
-      add_sleb128_atom(dinfo->lsec,lineoffs);
-      lineoffs = 0;
-    }
-
-    /* construct special opcode for simultaneous inst./pc-advancement */
-    spc_op = instoffs * dinfo->line_range + (lineoffs - dinfo->line_base) +
-             dinfo->opcode_base;
-
-    if (spc_op<0 || spc_op>0xff) {
-      /* not representable as a special opcode, so emit standard opcodes */
-      if (instoffs == dinfo->max_pcadvance)
-        add_data_atom(dinfo->lsec,1,1,DW_LNS_const_add_pc);
-      else if (instoffs)
-        ierror(0);
-      if (lineoffs) {
-        add_data_atom(dinfo->lsec,1,1,DW_LNS_advance_line);
-        add_sleb128_atom(dinfo->lsec,lineoffs);
-      }
-      add_data_atom(dinfo->lsec,1,1,DW_LNS_copy);  /* new matrix entry */
-    }
-    else
-      add_data_atom(dinfo->lsec,1,1,spc_op);  /* matrix entry by special op */
+    line_entry(dinfo,instoffs,lineoffs);
 
     /* update line/address */
     dinfo->address = sec->pc;
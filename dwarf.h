@@ -21,6 +21,8 @@ struct dwarf_info {
   int max_pcadvance;
   taddr address;
   int file,line,column,is_stmt,basic_block,end_sequence;
+  unsigned char *lbuf;    /* line program bytes not yet in .debug_line */
+  size_t lbuf_len,lbuf_size;
 };
 
 /* debug information tags and attributes */
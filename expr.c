@@ -6,6 +6,8 @@
 char current_pc_char='$';
 int unsigned_shift;
 int charsperexp;
+int share_exp;
+int dump_deps;
 
 static char *s;
 static symbol *cpc;
@@ -13,6 +15,70 @@ static int make_tmp_lab;
 static int exp_type;
 static int bitspertaddr,charspertaddr;
 
+/* Results of symbol evaluations are memoised in the symbol's expression
+   tree, tagged with an epoch which is renewed whenever a label moves.
+   The tree of an equate also refers to its dependencies, so its results
+   stay valid as long as none of the labels it depends on have moved. */
+struct expr_cache {
+  struct symdep *dep;
+  unsigned long epoch;
+  section *sec;
+  taddr pc;
+  taddr val;
+  int cnst;
+  int state;
+  unsigned long bepoch;
+  section *bsec;
+  taddr bpc;
+  symbol *base;
+  int bret;
+  int bstate;
+  struct expr_op *code;  /* compiled postfix code */
+  int ncode;             /* number of ops */
+  int depth;             /* required evaluation stack */
+};
+
+/* Postfix code: push a constant, evaluate a node from the values on the
+   stack, or evaluate a shared subtree, which has its own code. */
+struct expr_op {
+  int kind;
+  expr *node;
+  taddr val;
+};
+#define EOP_CONST 0
+#define EOP_NODE  1
+#define EOP_TREE  2
+#define EVALSTACK 32
+static unsigned long eval_epoch,last_epoch;
+static int evalstate;
+#define EVS_PCDEP   1  /* result depends on the pc */
+#define EVS_NOCACHE 2  /* result must not be memoised */
+static symbol nobase;  /* base symbol was not determined */
+
+/* reverse dependencies: the equates using a label's or equate's value */
+struct symdep {
+  struct symdep *next;    /* hash chain */
+  symbol *sym;
+  struct symdep **users;
+  int nusers,maxusers;
+  unsigned long dirty;    /* last epoch in which a dependency changed */
+};
+#define DEPHTSIZE 0x4000
+static struct symdep **symdeps;
+static struct symdep **depstack;
+static size_t depstacksize;
+static unsigned long clean_epoch;  /* last epoch invalidating everything */
+#define CACHE_VALID(c,e) ((e)==eval_epoch||\
+  ((c)->dep!=NULL&&(e)>=clean_epoch&&(e)>=(c)->dep->dirty))
+
+/* table of interned leaf nodes, when share_exp is set */
+struct intern_node {
+  struct intern_node *next;
+  expr *node;
+};
+#define INTERNHTSIZE 0x4000
+static struct intern_node **interned;
+
 static expr *expression(void);
 
 
@@ -41,6 +107,8 @@ expr *new_expr(void)
 {
   expr *new=mymalloc(sizeof(*new));
   new->left=new->right=0;
+  new->refs=1;
+  new->cache=0;
   return new;
 }
 
@@ -50,6 +118,8 @@ expr *make_expr(int type,expr *left,expr *right)
   new->left=left;
   new->right=right;
   new->type=type;
+  new->refs=1;
+  new->cache=0;
   return new;
 }
 
@@ -63,6 +133,94 @@ expr *copy_tree(expr *old)
   return new;
 }
 
+/* Add another owner to an expression tree. Shared trees are never
+   modified in place, so they must be released with free_expr(). */
+expr *share_expr(expr *tree)
+{
+  if(tree)
+    tree->refs++;
+  return tree;
+}
+
+static unsigned intern_hash(expr *p)
+{
+  uint64_t h;
+
+  switch(p->type){
+    case NUM: h=(uint64_t)p->c.val; break;
+    case HUG: h=p->c.huge.hi*31+p->c.huge.lo; break;
+    default:  h=(uint64_t)(size_t)p->c.sym>>3; break;
+  }
+  h+=(uint64_t)p->type*0x9e3779b97f4a7c15ULL;  /* odd multiplier */
+  h^=h>>32;
+  h^=h>>15;
+  return (unsigned)h&(INTERNHTSIZE-1);
+}
+
+static int same_leaf(expr *a,expr *b)
+{
+  if(a->type!=b->type)
+    return 0;
+  switch(a->type){
+    case NUM: return a->c.val==b->c.val;
+    case HUG: return a->c.huge.hi==b->c.huge.hi&&a->c.huge.lo==b->c.huge.lo;
+  }
+  return a->c.sym==b->c.sym;
+}
+
+/* Replace a private leaf node by the single shared node with the same
+   contents. The table keeps a reference on each interned node. */
+static expr *intern_leaf(expr *p)
+{
+  struct intern_node *in;
+  unsigned h;
+
+  if(!interned){
+    interned=mymalloc(INTERNHTSIZE*sizeof(struct intern_node *));
+    memset(interned,0,INTERNHTSIZE*sizeof(struct intern_node *));
+  }
+  h=intern_hash(p);
+  for(in=interned[h];in;in=in->next){
+    if(same_leaf(in->node,p)){
+      free_expr(p);
+      return share_expr(in->node);
+    }
+  }
+  in=mymalloc(sizeof(struct intern_node));
+  in->next=interned[h];
+  in->node=share_expr(p);
+  interned[h]=in;
+  return p;
+}
+
+/* Intern all numeric and symbol leaves of a simplified tree, which
+   includes the results of constant subexpressions. */
+static void intern_tree(expr **pp)
+{
+  expr *p=*pp;
+
+  if(!p||p->refs>1)
+    return;
+  if(p->type==NUM||p->type==HUG||p->type==SYM)
+    *pp=intern_leaf(p);
+  else{
+    intern_tree(&p->left);
+    intern_tree(&p->right);
+  }
+}
+
+/* Return a private copy of a shared subtree, releasing the shared one. */
+static expr *unshare_expr(expr *tree)
+{
+  expr *new;
+
+  if(tree->refs<=1)
+    return tree;
+  new=copy_tree(tree);
+  free_expr(tree);
+  return new;
+}
+
 expr *new_sym_expr(symbol *sym)
 {
   expr *new=new_expr();
@@ -83,6 +241,8 @@ expr *curpc_expr(void)
 
 static void update_curpc(expr *exp,section *sec,taddr pc)
 {
+  if(exp->c.sym==cpc)
+    evalstate|=EVS_NOCACHE;
   if(exp->c.sym==cpc&&sec!=NULL){
     cpc->sec=sec;
     cpc->pc=pc;
@@ -93,6 +253,39 @@ static void update_curpc(expr *exp,section *sec,taddr pc)
   }
 }
 
+/* Check whether simplify_expr() would modify the tree, e.g. because
+   a symbol in it became a constant in the meantime. */
+static int simplifiable(expr *tree)
+{
+  if(!tree)
+    return 0;
+  if(tree->type==SYM)
+    return tree->c.sym->type==EXPRESSION&&tree->c.sym->expr->type<SYM;
+  if(tree->left||tree->right){
+    if((!tree->left||tree->left->type<SYM)&&
+       (!tree->right||tree->right->type<SYM))
+      return 1;  /* constant operands */
+    if(tree->type==SUB&&tree->right->type==SYM&&tree->left->type==SUB&&
+       tree->left->left->type!=SYM&&tree->left->right->type==SYM)
+      return 1;  /* would be rearranged */
+  }
+  return simplifiable(tree->left)||simplifiable(tree->right);
+}
+
+/* Reference a symbol in an expression. An equate's tree is shared
+   instead of copied, unless it is still subject to simplification or
+   belongs to an internal symbol, which may be modified in place.
+   A SET-redefinition replaces sym->expr without touching the old tree,
+   so previous references keep the value valid at their position. */
+static expr *ref_sym_expr(symbol *sym)
+{
+  if(sym->type!=EXPRESSION)
+    return new_sym_expr(sym);
+  if((sym->flags&VASMINTERN)||simplifiable(sym->expr))
+    return copy_tree(sym->expr);
+  return share_expr(sym->expr);
+}
+
 static expr *primary_expr(void)
 {
   strbuf *buf;
@@ -116,7 +309,7 @@ static expr *primary_expr(void)
     if(!sym)
       sym=new_import(buf->str);
     sym->flags|=USED;
-    new=(sym->type!=EXPRESSION)?new_sym_expr(sym):copy_tree(sym->expr);
+    new=ref_sym_expr(sym);
     return new;
   }
   m=const_prefix(s,&base);
@@ -246,7 +439,7 @@ static expr *primary_expr(void)
       sym=new_import(buf->str);
     }
     sym->flags|=USED;
-    new=(sym->type!=EXPRESSION)?new_sym_expr(sym):copy_tree(sym->expr);
+    new=ref_sym_expr(sym);
     return new;
   }
   if(*s=='\''||*s=='\"'){
@@ -563,6 +756,8 @@ expr *parse_expr(char **pp)
   exp_type=NUM;
   tree=expression();
   simplify_expr(tree);
+  if(share_exp)
+    intern_tree(&tree);
   *pp=s;
   return tree;
 }
@@ -575,6 +770,8 @@ expr *parse_expr_tmplab(char **pp)
   exp_type=NUM;
   tree=expression();
   simplify_expr(tree);
+  if(share_exp)
+    intern_tree(&tree);
   *pp=s;
   return tree;
 }
@@ -589,6 +786,8 @@ expr *parse_expr_huge(char **pp)
   exp_type=HUG;
   tree=expression();
   simplify_expr(tree);
+  if(share_exp)
+    intern_tree(&tree);
   *pp=s;
   return tree;
 }
@@ -605,6 +804,8 @@ expr *parse_expr_float(char **pp)
   exp_type=FLT;
   tree=expression();
   simplify_expr(tree);
+  if(share_exp)
+    intern_tree(&tree);
   *pp=s;
   return tree;
 #else
@@ -615,10 +816,13 @@ expr *parse_expr_float(char **pp)
 
 void free_expr(expr *tree)
 {
-  if(!tree)
+  if(!tree||--tree->refs>0)
     return;
   free_expr(tree->left);
   free_expr(tree->right);
+  if(tree->cache)
+    myfree(tree->cache->code);
+  myfree(tree->cache);
   myfree(tree);
 }
 
@@ -648,13 +852,19 @@ int type_of_expr(expr *tree)
   return rtype>ltype?rtype:ltype;
 }
 
-/* Find pointer to first symbol occurrence inside expression tree */
+/* Find pointer to first symbol occurrence inside expression tree.
+   Shared subtrees are replaced by private copies on the way, as the
+   caller may modify the result. */
 expr **find_sym_expr(expr **ptree,char *name)
 {
   expr **psym;
 
   if(*ptree==NULL)
     return NULL;
+  if((*ptree)->left!=NULL)
+    (*ptree)->left=unshare_expr((*ptree)->left);
+  if((*ptree)->right!=NULL)
+    (*ptree)->right=unshare_expr((*ptree)->right);
   if((*ptree)->left!=NULL &&
      (*ptree)->left->type==SYM&&!strcmp((*ptree)->left->c.sym->name,name))
     return &(*ptree)->left;
@@ -696,8 +906,17 @@ void simplify_expr(expr *tree)
   tfloat fval;
 #endif
   int type=0;
-  if(!tree)
-    return;
+  if(!tree||tree->refs>1)
+    return;  /* shared trees are left alone */
+  if(tree->cache&&tree->cache->code){
+    /* compiled code refers to nodes which may disappear */
+    myfree(tree->cache->code);
+    tree->cache->code=NULL;
+  }
+  if(tree->left&&tree->left->refs>1&&simplifiable(tree->left))
+    tree->left=unshare_expr(tree->left);
+  if(tree->right&&tree->right->refs>1&&simplifiable(tree->right))
+    tree->right=unshare_expr(tree->right);
   simplify_expr(tree->left);
   simplify_expr(tree->right);
   if(tree->type==SUB&&tree->right->type==SYM&&tree->left->type==SUB&&
@@ -705,6 +924,7 @@ void simplify_expr(expr *tree)
     /* Rearrange nodes from "const-symbol-symbol", so that "symbol-symbol"
        is evaluated first, as it may yield a constant. */
     expr *x=tree->right;
+    tree->left=unshare_expr(tree->left);
     tree->right=tree->left;
     tree->left=tree->right->left;
     tree->right->left=tree->right->right;
@@ -1021,35 +1241,266 @@ void simplify_expr(expr *tree)
   tree->type=type;
 }
 
+/* Record that src has to be resolved again when dest changes. The
+   dependent section indices are kept as a sorted array, as most
+   sections depend on few others. */
 static void add_dep(section *src, section *dest)
 {
   if(num_secs&&src!=NULL&&src!=dest){
-    if(debug&&(!dest->deps||!BTST(dest->deps,src->idx)))
+    int idx=(int)src->idx;
+    int lo=0,hi=dest->ndeps;
+
+    while(lo<hi){
+      int mid=(lo+hi)/2;
+      if(dest->deps[mid]<idx)
+        lo=mid+1;
+      else
+        hi=mid;
+    }
+    if(lo<dest->ndeps&&dest->deps[lo]==idx)
+      return;
+    if(debug)
       printf("sec %s might depend on %s\n",src->name,dest->name);
-    if(!dest->deps){
-      dest->deps=mymalloc(BVSIZE(num_secs));
-      memset(dest->deps,0,BVSIZE(num_secs));
+    if(dest->ndeps>=dest->maxdeps){
+      dest->maxdeps=dest->maxdeps?2*dest->maxdeps:4;
+      dest->deps=myrealloc(dest->deps,dest->maxdeps*sizeof(int));
     }
-    BSET(dest->deps, src->idx);
+    memmove(&dest->deps[lo+1],&dest->deps[lo],
+            (dest->ndeps-lo)*sizeof(int));
+    dest->deps[lo]=idx;
+    dest->ndeps++;
   }
 }
 
-/* Evaluate an expression using current values of all symbols.
-   Result is written to *result. The return value specifies
-   whether the result is constant (i.e. only depending on
-   constants or absolute symbols). */
-int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
+static struct expr_cache *get_cache(expr *tree)
 {
-  taddr val,lval,rval;
-  symbol *lsym,*rsym;
-  int cnst=1,lbok,rbok;
+  if(!tree->cache){
+    tree->cache=mymalloc(sizeof(struct expr_cache));
+    tree->cache->dep=NULL;
+    tree->cache->epoch=tree->cache->bepoch=0;
+    tree->cache->code=NULL;
+  }
+  return tree->cache;
+}
 
-  if(!tree)
-    ierror(0);
-  if(tree->left&&!eval_expr(tree->left,&lval,sec,pc))
-    cnst=0;
-  if(tree->right&&!eval_expr(tree->right,&rval,sec,pc))
-    cnst=0;
+static struct symdep *find_dep(symbol *sym,int create)
+{
+  size_t h=(size_t)sym>>4;
+  struct symdep *d,**bucket;
+
+  bucket=&symdeps[(h^(h>>14))&(DEPHTSIZE-1)];
+  for(d=*bucket;d;d=d->next){
+    if(d->sym==sym)
+      return d;
+  }
+  if(create){
+    d=mymalloc(sizeof(struct symdep));
+    d->next=*bucket;
+    d->sym=sym;
+    d->users=NULL;
+    d->nusers=d->maxusers=0;
+    d->dirty=0;
+    *bucket=d;
+  }
+  return d;
+}
+
+static void add_user(struct symdep *d,struct symdep *user)
+{
+  if(d==user||(d->nusers>0&&d->users[d->nusers-1]==user))
+    return;
+  if(d->nusers>=d->maxusers){
+    d->maxusers=d->maxusers?2*d->maxusers:4;
+    d->users=myrealloc(d->users,d->maxusers*sizeof(struct symdep *));
+  }
+  d->users[d->nusers++]=user;
+}
+
+/* Make user depend on all labels and equates referenced in tree. A shared
+   subtree, which is another equate's tree, is a dependency of its own. */
+static void collect_deps(expr *tree,struct symdep *user,int top)
+{
+  for(;tree;tree=tree->right,top=0){
+    if(!top&&tree->cache&&tree->cache->dep){
+      add_user(tree->cache->dep,user);
+      return;
+    }
+    if(tree->type==SYM){
+      symbol *sym=tree->c.sym;
+
+      if(sym->type==LABSYM)
+        add_user(find_dep(sym,1),user);
+      else if(sym->type==EXPRESSION&&sym->expr&&
+              sym->expr->cache&&sym->expr->cache->dep)
+        add_user(sym->expr->cache->dep,user);
+      return;
+    }
+    collect_deps(tree->left,user,0);
+  }
+}
+
+/* Build the reverse dependency graph for all equates. Internal symbols
+   are excluded, because they are never memoised. */
+static void build_deps(void)
+{
+  struct symdep *d;
+  symbol *sym;
+  int i;
+
+  symdeps=mycalloc(DEPHTSIZE*sizeof(struct symdep *));
+  for(sym=first_symbol;sym;sym=sym->next){
+    if(sym->type==EXPRESSION&&sym->expr&&!(sym->flags&VASMINTERN)){
+      struct expr_cache *c=get_cache(sym->expr);
+
+      if(!c->dep)
+        c->dep=find_dep(sym,1);  /* equates may share the same tree */
+    }
+  }
+  for(sym=first_symbol;sym;sym=sym->next){
+    if(sym->type==EXPRESSION&&sym->expr&&!(sym->flags&VASMINTERN)&&
+       sym->expr->cache->dep->sym==sym)
+      collect_deps(sym->expr,sym->expr->cache->dep,1);
+  }
+
+  if(dump_deps){
+    printf("symbol dependencies:\n");
+    for(sym=first_symbol;sym;sym=sym->next){
+      if((d=find_dep(sym,0))!=NULL&&d->nusers>0){
+        printf("  %s:",sym->name);
+        for(i=0;i<d->nusers;i++)
+          printf(" %s",d->users[i]->sym->name);
+        putchar('\n');
+      }
+    }
+  }
+}
+
+static void free_deps(void)
+{
+  struct symdep *d,*next;
+  int i;
+
+  for(i=0;i<DEPHTSIZE;i++){
+    for(d=symdeps[i];d;d=next){
+      next=d->next;
+      if(d->sym->type==EXPRESSION&&d->sym->expr->cache->dep==d)
+        d->sym->expr->cache->dep=NULL;
+      myfree(d->users);
+      myfree(d);
+    }
+  }
+  myfree(symdeps);
+  symdeps=NULL;
+}
+
+/* Enable or disable memoisation of symbol values and bases. Must only be
+   enabled while no symbols are defined and no expressions are modified,
+   i.e. while resolving the sections. */
+void eval_cache(int enable)
+{
+#ifdef EXT_FIND_BASE
+  /* the cpu's find_base extension may rewrite expressions */
+  enable=0;
+#endif
+  eval_epoch=enable?++last_epoch:0;
+  clean_epoch=eval_epoch;
+  if(enable&&!symdeps)
+    build_deps();
+  else if(!enable&&symdeps)
+    free_deps();
+}
+
+/* Invalidate all memoised results, e.g. after changing cpu options. */
+void new_eval_epoch(void)
+{
+  if(eval_epoch)
+    clean_epoch=eval_epoch=++last_epoch;
+}
+
+/* A label has moved. Start a new epoch and invalidate the memoised values
+   of all equates depending on this label, directly or indirectly.
+   Returns the number of these equates. */
+int label_moved(symbol *label)
+{
+  struct symdep *d;
+  size_t sp=0;
+  int i,n=0;
+
+  if(!eval_epoch)
+    return 0;
+  eval_epoch=++last_epoch;
+  if((d=find_dep(label,0))==NULL)
+    return 0;
+  for(;;){
+    for(i=0;i<d->nusers;i++){
+      struct symdep *u=d->users[i];
+
+      if(u->dirty!=eval_epoch){
+        u->dirty=eval_epoch;
+        n++;
+        if(sp>=depstacksize){
+          depstacksize=depstacksize?2*depstacksize:64;
+          depstack=myrealloc(depstack,depstacksize*sizeof(struct symdep *));
+        }
+        depstack[sp++]=u;
+      }
+    }
+    if(sp==0)
+      break;
+    d=depstack[--sp];
+  }
+  return n;
+}
+
+
+/* Evaluate a symbol's or other shared tree, or take the result from its
+   cache, when no label it depends on has moved since, and the section
+   and pc still match. */
+static int eval_shared(expr *tree,int nocache,taddr *result,
+                       section *sec,taddr pc)
+{
+  struct expr_cache *c=tree->cache;
+  int outer=evalstate,cnst;
+
+  if(c&&eval_epoch&&CACHE_VALID(c,c->epoch)&&c->sec==sec&&
+     (!(c->state&EVS_PCDEP)||c->pc==pc)){
+    evalstate|=c->state;
+    *result=c->val;
+    return c->cnst;
+  }
+  evalstate=nocache?EVS_NOCACHE:0;
+  cnst=eval_expr(tree,result,sec,pc);
+  if(eval_epoch&&!(evalstate&EVS_NOCACHE)){
+    c=get_cache(tree);
+    c->epoch=eval_epoch;
+    c->sec=sec;
+    c->pc=pc;
+    c->val=*result;
+    c->cnst=cnst;
+    c->state=evalstate;
+  }
+  evalstate|=outer;
+  return cnst;
+}
+
+static int eval_sym(symbol *sym,taddr *result,section *sec,taddr pc)
+{
+  int cnst;
+
+  sym->flags|=INEVAL;
+  cnst=eval_shared(sym->expr,sym->flags&VASMINTERN,result,sec,pc);
+  sym->flags&=~INEVAL;
+  return cnst;
+}
+
+/* Evaluate a single node, given the values of its operands. cnst is
+   zero when one of the operands is not constant. */
+static int eval_node(expr *tree,taddr lval,taddr rval,int cnst,
+                     taddr *result,section *sec,taddr pc)
+{
+  taddr val;
+  symbol *lsym,*rsym;
+  int lbok,rbok;
 
   switch(tree->type){
   case ADD:
@@ -1075,6 +1526,7 @@ int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
         }else{
           /* prepare a value which works with REL_PC */
           val=(pc-rval+lval-(lsym->sec?lsym->sec->org:0));
+          evalstate|=EVS_PCDEP;
           break;
         }
       }else if(!lbok&&(rsym->flags&ABSLABEL)){
@@ -1168,9 +1620,7 @@ int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
     if(lsym->type==EXPRESSION){
       if(lsym->flags&INEVAL)
         general_error(18,lsym->name);
-      lsym->flags|=INEVAL;
-      cnst=eval_expr(lsym->expr,&val,sec,pc);
-      lsym->flags&=~INEVAL;
+      cnst=eval_sym(lsym,&val,sec,pc);
     }else if(LOCREF(lsym)){
       update_curpc(tree,sec,pc);
       val=lsym->pc;
@@ -1209,6 +1659,165 @@ int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
   return cnst;
 }
 
+static int eval_tree(expr *tree,taddr *result,section *sec,taddr pc)
+{
+  taddr lval,rval;
+  int cnst=1;
+
+  if(!tree)
+    ierror(0);
+  if(tree->left&&!eval_tree(tree->left,&lval,sec,pc))
+    cnst=0;
+  if(tree->right&&!eval_tree(tree->right,&rval,sec,pc))
+    cnst=0;
+  return eval_node(tree,lval,rval,cnst,result,sec,pc);
+}
+
+/* Operations which can neither fail nor depend on anything, so they
+   are folded at compile time, when all operands are constant. */
+static int foldable(int type)
+{
+  switch(type){
+    case ADD: case SUB: case MUL: case LAND: case LOR: case BAND: case BOR:
+    case XOR: case LSH: case RSH: case RSHU: case LT: case GT: case LEQ:
+    case GEQ: case NEQ: case EQ: case NEG: case CPL: case NOT:
+      return 1;
+  }
+  return 0;
+}
+
+/* Emit the postfix code for a tree. Returns the next free slot and
+   updates the maximum stack depth. */
+static struct expr_op *compile_tree(expr *tree,struct expr_op *op,
+                                    int depth,int *maxdepth,int top)
+{
+  struct expr_op *lop=NULL,*rop=NULL;
+
+  if(++depth>*maxdepth)
+    *maxdepth=depth;
+  if(tree->type==NUM){
+    op->kind=EOP_CONST;
+    op->val=tree->c.val;
+    return op+1;
+  }
+  if(!top&&tree->refs>1&&(tree->left||tree->right)){
+    /* an equate's tree, referenced from many expressions */
+    op->kind=EOP_TREE;
+    op->node=tree;
+    return op+1;
+  }
+  if(tree->left){
+    lop=op;
+    op=compile_tree(tree->left,op,depth-1,maxdepth,0);
+  }
+  if(tree->right){
+    rop=op;
+    op=compile_tree(tree->right,op,depth,maxdepth,0);
+  }
+  if(lop&&foldable(tree->type)&&lop->kind==EOP_CONST&&
+     (rop?rop==lop+1&&rop->kind==EOP_CONST&&op==rop+1:op==lop+1)){
+    /* constant operands: replace them by the result */
+    eval_node(tree,lop->val,rop?rop->val:0,1,&lop->val,NULL,0);
+    return lop+1;
+  }
+  op->kind=EOP_NODE;
+  op->node=tree;
+  return op+1;
+}
+
+static int count_nodes(expr *tree)
+{
+  return tree?1+count_nodes(tree->left)+count_nodes(tree->right):0;
+}
+
+/* Translate a tree into a flat postfix array, which is evaluated without
+   recursion. */
+static void compile_expr(expr *tree)
+{
+  struct expr_cache *c=get_cache(tree);
+  struct expr_op *end;
+  int depth=0;
+
+  c->code=mymalloc(count_nodes(tree)*sizeof(struct expr_op));
+  end=compile_tree(tree,c->code,0,&depth,1);
+  c->ncode=end-c->code;
+  c->depth=depth;
+}
+
+static int eval_code(struct expr_cache *c,taddr *result,section *sec,taddr pc)
+{
+  taddr vbuf[EVALSTACK],*val,lval,rval;
+  char cbuf[EVALSTACK],*cnst;
+  struct expr_op *op=c->code,*end=op+c->ncode;
+  expr *tree;
+  int sp=0,k;
+
+  if(c->depth>EVALSTACK){
+    val=mymalloc(c->depth*sizeof(taddr));
+    cnst=mymalloc(c->depth);
+  }
+  else{
+    val=vbuf;
+    cnst=cbuf;
+  }
+
+  for(;op<end;op++){
+    if(op->kind==EOP_CONST){
+      val[sp]=op->val;
+      cnst[sp++]=1;
+      continue;
+    }
+    tree=op->node;
+    if(op->kind==EOP_TREE){
+      cnst[sp]=eval_shared(tree,0,&val[sp],sec,pc);
+      sp++;
+      continue;
+    }
+    k=1;
+    lval=rval=0;  /* unused operand of unary operators */
+    if(tree->right){
+      rval=val[--sp];
+      k&=cnst[sp];
+    }
+    if(tree->left){
+      lval=val[--sp];
+      k&=cnst[sp];
+    }
+    cnst[sp]=eval_node(tree,lval,rval,k,&val[sp],sec,pc);
+    sp++;
+  }
+  if(sp!=1)
+    ierror(0);  /* unbalanced postfix code */
+  *result=val[0];
+  k=cnst[0];
+  if(val!=vbuf){
+    myfree(val);
+    myfree(cnst);
+  }
+  return k;
+}
+
+/* Evaluate an expression using current values of all symbols.
+   Result is written to *result. The return value specifies
+   whether the result is constant (i.e. only depending on
+   constants or absolute symbols).
+   Trees evaluated while resolving are evaluated again in every pass,
+   so they are compiled into postfix code on first use. */
+int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
+{
+  struct expr_cache *c;
+
+  if(!tree)
+    ierror(0);
+  if((c=tree->cache)!=NULL&&c->code!=NULL)
+    return eval_code(c,result,sec,pc);
+  if(eval_epoch&&(tree->left||tree->right)){
+    compile_expr(tree);
+    return eval_code(tree->cache,result,sec,pc);
+  }
+  return eval_tree(tree,result,sec,pc);
+}
+
 /* Evaluate a huge integer expression using current values of all symbols.
    Result is written to *result. The return value specifies whether all
    operations were valid. */
@@ -1440,6 +2049,39 @@ void print_expr(FILE *f,expr *p)
     fprintf(f,"complex expression");
 }
 
+static int _find_base(expr *,symbol **,section *,taddr);
+
+/* Find the base of an EXPRESSION symbol, or take it from its cache. */
+static int base_sym(symbol *sym,symbol **base,section *sec,taddr pc)
+{
+  struct expr_cache *c=sym->expr->cache;
+  symbol *b=&nobase;
+  int outer=evalstate,ret;
+
+  if(c&&eval_epoch&&CACHE_VALID(c,c->bepoch)&&c->bsec==sec&&
+     (!(c->bstate&EVS_PCDEP)||c->bpc==pc)){
+    evalstate|=c->bstate;
+    if(base&&c->base!=&nobase)
+      *base=c->base;
+    return c->bret;
+  }
+  evalstate=(sym->flags&VASMINTERN)?EVS_NOCACHE:0;
+  ret=_find_base(sym->expr,&b,sec,pc);
+  if(eval_epoch&&!(evalstate&EVS_NOCACHE)){
+    c=get_cache(sym->expr);
+    c->bepoch=eval_epoch;
+    c->bsec=sec;
+    c->bpc=pc;
+    c->base=b;
+    c->bret=ret;
+    c->bstate=evalstate;
+  }
+  evalstate|=outer;
+  if(base&&b!=&nobase)
+    *base=b;
+  return ret;
+}
+
 static int _find_base(expr *p,symbol **base,section *sec,taddr pc)
 {
 #ifdef EXT_FIND_BASE
@@ -1450,7 +2092,7 @@ static int _find_base(expr *p,symbol **base,section *sec,taddr pc)
   if(p->type==SYM){
     update_curpc(p,sec,pc);
     if(p->c.sym->type==EXPRESSION)
-      return _find_base(p->c.sym->expr,base,sec,pc);
+      return base_sym(p->c.sym,base,sec,pc);
     else{
       if(base)
         *base=p->c.sym;  /* set base to symbol, also when BASE_ILLEGAL later */
@@ -1459,17 +2101,17 @@ static int _find_base(expr *p,symbol **base,section *sec,taddr pc)
   }
   if(p->type==ADD){
     taddr val;
-    if(eval_expr(p->left,&val,sec,pc)&&
+    if(eval_tree(p->left,&val,sec,pc)&&
        _find_base(p->right,base,sec,pc)==BASE_OK)
       return BASE_OK;
-    if(eval_expr(p->right,&val,sec,pc)&&
+    if(eval_tree(p->right,&val,sec,pc)&&
        _find_base(p->left,base,sec,pc)==BASE_OK)
       return BASE_OK;
   }
   if(p->type==SUB){
     taddr val;
     symbol *pcsym;
-    if(eval_expr(p->right,&val,sec,pc)&&
+    if(eval_tree(p->right,&val,sec,pc)&&
        _find_base(p->left,base,sec,pc)==BASE_OK)
       return BASE_OK;
     if(_find_base(p->left,base,sec,pc)==BASE_OK&&
@@ -13,8 +13,10 @@ enum {
 
 struct expr {
   int type;
+  int refs;  /* number of owners, >1 for shared equate trees */
   struct expr *left;
   struct expr *right;
+  struct expr_cache *cache;  /* memoised results, see eval_cache() */
   union {
     taddr val;
     tfloat flt;
@@ -39,6 +41,8 @@ struct expr {
 /* global variables */
 extern char current_pc_char;
 extern int unsigned_shift;
+extern int share_exp;
+extern int dump_deps;
 extern int charsperexp;
 
 /* functions */
@@ -46,6 +50,7 @@ int init_expr(void);
 expr *new_expr(void);
 expr *make_expr(int,expr *,expr *);
 expr *copy_tree(expr *);
+expr *share_expr(expr *);
 expr *new_sym_expr(symbol *);
 expr *curpc_expr(void);
 expr *parse_expr(char **);
@@ -63,6 +68,9 @@ int eval_expr(expr *,taddr *,section *,taddr);
 int eval_expr_huge(expr *,thuge *);
 void print_expr(FILE *,expr *);
 int find_base(expr *,symbol **,section *,taddr);
+void eval_cache(int);
+void new_eval_epoch(void);
+int label_moved(symbol *);
 #if FLOAT_PARSER
 expr *float_expr(tfloat);
 int eval_expr_float(expr *,tfloat *);
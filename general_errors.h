@@ -87,3 +87,5 @@
   "missing definition for symbol <%s>",NOLINE|WARNING,
   "additional macro arguments ignored (expecting %d)",WARNING,
   "macro previously defined at line %d of %s",WARNING,
+  "output format <%s> selected multiple times",NOLINE|ERROR|FATAL,
+  "no output file name given for output format <%s>",NOLINE|ERROR|FATAL, /* 90 */
@@ -13,6 +13,27 @@
 
 typedef uint32_t digit;
 
+#if defined(__SIZEOF_INT128__) && !defined(NO_NATIVE_HUGE)
+/* GCC and Clang provide 128-bit integers on 64-bit hosts */
+#define NATIVE_HUGE 1
+__extension__ typedef unsigned __int128 nhuge;
+__extension__ typedef __int128 snhuge;
+
+static nhuge to_native(thuge h)
+{
+  return ((nhuge)h.hi << 64) | h.lo;
+}
+
+static thuge from_native(nhuge n)
+{
+  thuge r;
+
+  r.hi = (uint64_t)(n >> 64);
+  r.lo = (uint64_t)n;
+  return r;
+}
+#endif
+
 
 thuge huge_zero(void)
 {
@@ -204,6 +225,26 @@ thuge hxor(thuge a,thuge b)
 }
 
 
+#ifdef NATIVE_HUGE
+thuge haddi(thuge a,int64_t b)
+{
+  return from_native(to_native(a) + (nhuge)(snhuge)b);
+}
+
+
+thuge hadd(thuge a,thuge b)
+{
+  return from_native(to_native(a) + to_native(b));
+}
+
+
+thuge hsub(thuge a,thuge b)
+{
+  return from_native(to_native(a) - to_native(b));
+}
+
+#else /* !NATIVE_HUGE */
+
 thuge haddi(thuge a,int64_t b)
 {
   thuge r;
@@ -222,10 +263,7 @@ thuge hadd(thuge a,thuge b)
   thuge r;
 
   r.lo = a.lo + b.lo;
-  if (HUGESIGN(b))
-    r.hi = (r.lo>a.lo) ? a.hi + b.hi - 1 : a.hi + b.hi;
-  else
-    r.hi = (r.lo<a.lo) ? a.hi + b.hi + 1 : a.hi + b.hi;
+  r.hi = (r.lo<a.lo) ? a.hi + b.hi + 1 : a.hi + b.hi;
   return r;
 }
 
@@ -235,12 +273,10 @@ thuge hsub(thuge a,thuge b)
   thuge r;
 
   r.lo = a.lo - b.lo;
-  if (HUGESIGN(b))
-    r.hi = (r.lo<a.lo) ? a.hi - b.hi + 1 : a.hi - b.hi;
-  else
-    r.hi = (r.lo>a.lo) ? a.hi - b.hi - 1 : a.hi - b.hi;
+  r.hi = (a.lo<b.lo) ? a.hi - b.hi - 1 : a.hi - b.hi;
   return r;
 }
+#endif /* NATIVE_HUGE */
 
 
 int hcmp(thuge a,thuge b)
@@ -313,6 +349,34 @@ thuge hshl(thuge a,int b)
 }
 
 
+#ifdef NATIVE_HUGE
+thuge hmuli(thuge a,int64_t b)
+{
+  return from_native(to_native(a) * (uint64_t)b);
+}
+
+
+thuge hmul(thuge a,thuge b)
+{
+  return from_native(to_native(a) * to_native(b));
+}
+
+
+static thuge divmod(thuge a,thuge b,thuge *modptr)
+{
+  nhuge na,nb;
+
+  if (b.hi == 0 && b.lo == 0)
+    ierror(0);  /* division by zero */
+  na = to_native(a);
+  nb = to_native(b);
+  if (modptr)
+    *modptr = from_native(na % nb);
+  return from_native(na / nb);
+}
+
+#else /* !NATIVE_HUGE */
+
 thuge hmuli(thuge a,int64_t b)
 {
   uint64_t tmp,carry,ub;
@@ -326,8 +390,8 @@ thuge hmuli(thuge a,int64_t b)
   if (carry < tmp)
     r.hi += BASE;
   r.hi += HIHALF(carry);
-  tmp = HIHALF(a.lo) * HIHALF(ub);
-  r.hi += tmp;
+  r.hi += HIHALF(a.lo) * HIHALF(ub);
+  tmp = LOHALF(a.lo) * LOHALF(ub);
   if (tmp + (carry << HALF_BITS) < tmp)
     r.hi++;
   return r;
@@ -346,8 +410,8 @@ thuge hmul(thuge a,thuge b)
   if (carry < tmp)
     r.hi += BASE;
   r.hi += HIHALF(carry);
-  tmp = HIHALF(a.lo) * HIHALF(b.lo);
-  r.hi += tmp;
+  r.hi += HIHALF(a.lo) * HIHALF(b.lo);
+  tmp = LOHALF(a.lo) * LOHALF(b.lo);
   if (tmp + (carry << HALF_BITS) < tmp)
     r.hi++;
   return r;
@@ -494,6 +558,7 @@ qhat_too_big:
   r.lo = COMBINE(qspace[3],qspace[4]);
   return r;
 }
+#endif /* NATIVE_HUGE */
 
 
 thuge hdiv(thuge a,thuge b)
@@ -16,7 +16,12 @@ int listformfeed=1,listlinesperpage=40;
 listing *first_listing,*last_listing,*cur_listing;
 
 static listing *prev_listing;
+static listing **listchunks;
+static int nlistchunks,listchunk_used=LISTCHUNK;
+static char *txtpool;
+static size_t txtpool_free;
 static int listbpl,listnoinc,listformat,listtitlecnt,listall,listlabelsonly;
+static int listcycles;
 static char **listtitles;
 static int *listtitlelines;
 
@@ -44,6 +49,12 @@ int listing_option(char *arg)
       listbpl = val;
     return 1;
   }
+#if HAVE_INSTRUCTION_CYCLES
+  if (!strcmp("cyc",arg)) {
+    listcycles = 1;
+    return 1;
+  }
+#endif
   if (!strncmp("fmt=",arg,4)) {
     set_listformat(&arg[4]);
     return 1;
@@ -74,7 +85,15 @@ int listing_option(char *arg)
 
 listing *new_listing(source *src,int line)
 {
-  listing *new = mymalloc(sizeof(*new));
+  listing *new;
+
+  if (listchunk_used >= LISTCHUNK) {
+    /* allocate the next array of listing records */
+    listchunks = myrealloc(listchunks,(nlistchunks+1)*sizeof(listing *));
+    listchunks[nlistchunks++] = mymalloc(LISTCHUNK*sizeof(listing));
+    listchunk_used = 0;
+  }
+  new = &listchunks[nlistchunks-1][listchunk_used++];
 
   new->next = NULL;
   new->line = line;
@@ -83,6 +102,9 @@ listing *new_listing(source *src,int line)
   new->sec = 0;
   new->pc = 0;
   new->src = src;
+  new->txt = NULL;
+  new->len = 0;
+  new->cycles = 0;
 
   if (first_listing) {
     last_listing->next = new;
@@ -95,16 +117,53 @@ listing *new_listing(source *src,int line)
   return new;
 }
 
+/* Set the source text of a listing record. Usually it refers to the
+   source text itself, which stays in memory. Lines which differ from
+   the source text, like those with expanded macro arguments, have to
+   be copied into the text pool. */
+void set_listing_text(listing *l,const char *p,size_t len,int copy)
+{
+  if (len >= MAXLISTSRC)
+    len = MAXLISTSRC - 1;
+  if (copy) {
+    if (len > txtpool_free) {
+      txtpool_free = LISTCHUNK * MAXLISTSRC / 8;
+      txtpool = mymalloc(txtpool_free);
+    }
+    memcpy(txtpool,p,len);
+    p = txtpool;
+    txtpool += len;
+    txtpool_free -= len;
+  }
+  l->txt = p;
+  l->len = len;
+}
+
 /* used for example to suppress output of NOLIST directives */
 void del_last_listing(void)
 {
   if (listena && prev_listing!=NULL) {
-    myfree(last_listing);
+    if (listchunk_used>0 &&
+        last_listing==&listchunks[nlistchunks-1][listchunk_used-1])
+      listchunk_used--;  /* reuse the record */
     last_listing = prev_listing;
     last_listing->next = prev_listing = NULL;
   }
 }
 
+static void free_listing(void)
+{
+  int i;
+
+  for (i=0; i<nlistchunks; i++)
+    myfree(listchunks[i]);
+  myfree(listchunks);
+  listchunks = NULL;
+  nlistchunks = 0;
+  listchunk_used = LISTCHUNK;
+  first_listing = last_listing = prev_listing = cur_listing = NULL;
+}
+
 void set_listing(int on)
 {
   listena = on && produce_listing;
@@ -235,7 +294,7 @@ static void write_listing_old(char *listname,section *first_section)
     }else
       fprintf(f,"                           ");
 
-    fprintf(f," %-.77s",p->txt);
+    fprintf(f," %.*s",p->len<77?p->len:77,p->txt);
 
     /* bei laengeren Daten den Rest ueberspringen */
     /* Block entfernen, wenn alles ausgegeben werden soll */
@@ -320,11 +379,6 @@ static void write_listing_old(char *listname,section *first_section)
   else
     fprintf(f,"\nThere have been %d errors!\n",errors);
   fclose(f);
-  for(p=first_listing;p;){
-    listing *m=p->next;
-    myfree(p);
-    p=m;
-  }
 }
 #else
 static void write_listing_old(char *listname,section *first_section)
@@ -353,7 +407,8 @@ static void write_listing_old(char *listname,section *first_section)
       sprintf(err,"     ");
     if(p->src&&p->src->id>maxsrc)
       maxsrc=p->src->id;
-    fprintf(f,"F%02d:%04d %s %s",(int)(p->src?p->src->id:0),p->line,err,p->txt);
+    fprintf(f,"F%02d:%04d %s %.*s",(int)(p->src?p->src->id:0),p->line,err,
+            p->len,p->txt);
     a=p->atom;
     pc=p->pc;
     while(a){
@@ -399,14 +454,114 @@ static void write_listing_old(char *listname,section *first_section)
   else
     fprintf(f,"\nThere have been %d errors!\n",errors);
   fclose(f);
-  for(p=first_listing;p;){
-    listing *m=p->next;
-    myfree(p);
-    p=m;
-  }
 }
 #endif
 
+static void print_srcline(FILE *f,listing *l,char stype)
+{
+  if (listcycles) {
+    if (l->cycles)
+      fprintf(f,"%5d ",l->cycles);
+    else
+      fprintf(f,"      ");
+  }
+  fprintf(f,"%6d%c %.*s",l->line,stype,l->len,l->txt);
+}
+
+/* instruction cycles or a global label at a section offset */
+struct cycpos {
+  section *sec;
+  taddr pc;
+  symbol *label;
+  int cycles;
+};
+
+static int cycposcmp(const void *p1,const void *p2)
+{
+  const struct cycpos *a = p1;
+  const struct cycpos *b = p2;
+
+  if (a->sec != b->sec)
+    return a->sec->idx < b->sec->idx ? -1 : 1;
+  if (a->pc != b->pc)
+    return a->pc < b->pc ? -1 : 1;
+  if ((a->label==NULL) != (b->label==NULL))
+    return a->label ? -1 : 1;  /* labels before instructions */
+  return 0;
+}
+
+static size_t get_cycpos(struct cycpos *cp)
+{
+  size_t cnt = 0;
+  listing *l;
+  atom *a;
+
+  for (l=first_listing; l; l=l->next) {
+    if (l->sec == NULL)
+      continue;
+    if (l->cycles) {
+      if (cp != NULL) {
+        cp[cnt].sec = l->sec;
+        cp[cnt].pc = l->pc;
+        cp[cnt].label = NULL;
+        cp[cnt].cycles = l->cycles;
+      }
+      cnt++;
+    }
+    for (a=l->atom; a!=NULL && a->list==l; a=a->next) {
+      if (a->type==LABEL && *a->content.label->name!=' ' &&
+          !(a->content.label->flags & VASMINTERN)) {
+        if (cp != NULL) {
+          cp[cnt].sec = l->sec;
+          cp[cnt].pc = l->pc;
+          cp[cnt].label = a->content.label;
+          cp[cnt].cycles = 0;
+        }
+        cnt++;
+      }
+    }
+  }
+  return cnt;
+}
+
+/* Print the sum of instruction cycles for each section, and for each
+   global label up to the next global label in the same section. */
+static void write_cycle_totals(FILE *f,section *first_section,int addrw)
+{
+  size_t n = get_cycpos(NULL);
+  struct cycpos *cp = mymalloc((n+1)*sizeof(struct cycpos));
+  unsigned long sum;
+  section *secp;
+  size_t i,j,k;
+
+  get_cycpos(cp);
+  qsort(cp,n,sizeof(struct cycpos),cycposcmp);
+
+  fprintf(f,"\n\nCycles by section:\n");
+  for (secp=first_section,i=0; secp; secp=secp->next) {
+    for (sum=0; i<n && cp[i].sec==secp; i++)
+      sum += cp[i].cycles;
+    if (sum)
+      fprintf(f,"%02X: \"%s\" %lu\n",(unsigned)secp->idx,secp->name,sum);
+  }
+
+  fprintf(f,"\nCycles by label:\n");
+  for (i=0; i<n; i=k) {
+    /* labels at the same address share the range up to the next label */
+    for (j=i; j<n && cp[j].label!=NULL && cp[j].sec==cp[i].sec &&
+              cp[j].pc==cp[i].pc; j++);
+    for (sum=0,k=j; k<n && cp[k].label==NULL && cp[k].sec==cp[i].sec; k++)
+      sum += cp[k].cycles;
+    if (sum) {
+      for (; i<j; i++)
+        fprintf(f,"%02X:%0*llX %-31s %lu\n",(unsigned)cp[i].sec->idx,
+                addrw,MADDR(cp[i].pc),cp[i].label->name,sum);
+    }
+  }
+
+  myfree(cp);
+}
+
 static void write_listing_wide(char *listname,section *first_section)
 {
   int addrw = (bytespertaddr*BITSPERBYTE+3)/4;  /* width of address field */
@@ -463,7 +618,9 @@ static void write_listing_wide(char *listname,section *first_section)
           if (!(i % listbpl)) {
             if (i) {
               if (!flag) {
-                fprintf(f,"\t%6d%c %s\n",l->line,stype,l->txt);
+                fputc('\t',f);
+                print_srcline(f,l,stype);
+                fputc('\n',f);
                 flag = 1;
               }
               else
@@ -484,7 +641,9 @@ static void write_listing_wide(char *listname,section *first_section)
             if (!(i % listbpl)) {
               if (i) {
                 if (!flag) {
-                  fprintf(f,"\t%6d%c %s\n",l->line,stype,l->txt);
+                  fputc('\t',f);
+                  print_srcline(f,l,stype);
+                  fputc('\n',f);
                   flag = 1;
                 }
                 else
@@ -502,8 +661,8 @@ static void write_listing_wide(char *listname,section *first_section)
       }
       if (i) {
         if (!flag) {
-          fprintf(f,"%*c%6d%c %s",
-                  bytew*(listbpl-i)+1,'\t',l->line,stype,l->txt);
+          fprintf(f,"%*c",bytew*(listbpl-i)+1,'\t');
+          print_srcline(f,l,stype);
           if (spc) {
             fprintf(f,"\n%02X:%0*llX *",
                     (unsigned)(l->sec?l->sec->idx:0),
@@ -523,13 +682,19 @@ static void write_listing_wide(char *listname,section *first_section)
       else
         a = NULL;
     }
-    if (!flag)  /* no data generated for this source line */
-      fprintf(f,"%*c%6d%c %s\n",
-              4+addrw+bytew*listbpl+1,'\t',l->line,stype,l->txt);
+    if (!flag) {  /* no data generated for this source line */
+      fprintf(f,"%*c",4+addrw+bytew*listbpl+1,'\t');
+      print_srcline(f,l,stype);
+      fputc('\n',f);
+    }
     if (l->error)
-      fprintf(f,"%*c     ^-ERROR:%04d\n",4+addrw+bytew*listbpl+1,'\t',l->error);
+      fprintf(f,"%*c%*s     ^-ERROR:%04d\n",4+addrw+bytew*listbpl+1,'\t',
+              listcycles?6:0,"",l->error);
   }
 
+  if (listcycles)
+    write_cycle_totals(f,first_section,addrw);
+
   if (!listnosyms) {
     size_t nsyms = get_symbols(NULL,USEDMASK);
     symbol *sym,**symlist;
@@ -621,4 +786,5 @@ void set_listformat(const char *fmtname)
 void write_listing(char *listname,section *first_section)
 {
   list_format_table[listformat].fmtfunction(listname,first_section);
+  free_listing();
 }
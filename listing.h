@@ -5,7 +5,8 @@
 #define LISTING_H
 
 /* listing table */
-#define MAXLISTSRC 120
+#define MAXLISTSRC 120  /* max. characters of a source line to list */
+#define LISTCHUNK 1024  /* listing records are allocated in arrays of this */
 
 struct listing {
   listing *next;
@@ -15,7 +16,9 @@ struct listing {
   atom *atom;
   section *sec;
   taddr pc;
-  char txt[MAXLISTSRC];
+  const char *txt;  /* source line, usually points into src->text */
+  int len;          /* length of source line text, not 0-terminated */
+  int cycles;       /* execution cycles of the line's instructions, 0=none */
 };
 
 extern int produce_listing,listena;
@@ -25,6 +28,7 @@ extern listing *first_listing,*last_listing,*cur_listing;
 int init_listing(void);
 int listing_option(char *);
 listing *new_listing(source *,int);
+void set_listing_text(listing *,const char *,size_t,int);
 void del_last_listing(void);
 void set_listing(int);
 void set_list_title(char *,int);
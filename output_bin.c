@@ -4,7 +4,7 @@
 #include "vasm.h"
 
 #ifdef OUTBIN
-static char *copyright="vasm binary output module 2.3e (c) 2002-2025 Volker Barthelmann and Frank Wille";
+static char *copyright="vasm binary output module 2.3f (c) 2002-2025 Volker Barthelmann and Frank Wille";
 
 enum {
   BINFMT_RAW,           /* no header */
@@ -22,7 +22,7 @@ enum {
 static int binfmt = BINFMT_RAW;
 static char *exec_symname;
 static taddr exec_addr,joinorg;
-static int addrbits,coalesce,joinsecs;
+static int addrbits,coalesce,joinsecs,sparse,splitsecs;
 
 
 static int orgcmp(const void *sec1,const void *sec2)
@@ -35,8 +35,59 @@ static int orgcmp(const void *sec1,const void *sec2)
 }
 
 
+static int zeropad(section *s)
+/* check whether the section's padding pattern consists of zeros only */
+{
+  int i;
+
+  for (i=0; i<OCTETS(s->padbytes); i++) {
+    if (s->pad[i])
+      return 0;
+  }
+  return 1;
+}
+
+
+static void fwgap(FILE *f,section *s,unsigned long long n)
+/* Fill the gap of n target-bytes in front of section s with its padding.
+   In sparse mode zero-padding is done by seeking past the end of file,
+   so the file system may create a hole instead of writing all bytes. */
+{
+  unsigned long long skip;
+  long chunk;
+
+  if (sparse && n>1 && zeropad(s) && fseek(f,0,SEEK_CUR)==0) {
+    /* seek over all but the last byte, which is written to extend the file */
+    for (skip=OCTETS(n-1); skip>0; skip-=chunk) {
+      chunk = skip>0x40000000 ? 0x40000000 : (long)skip;
+      if (fseek(f,chunk,SEEK_CUR) != 0)
+        output_error(2);  /* write error */
+    }
+    fwspace(f,OCTETS(1));
+  }
+  else
+    fwpattern(f,n,s->pad,s->padbytes);
+}
+
+
+static FILE *open_split_file(section *s)
+/* open a new output file for section s, named <outname>.<address> */
+{
+  char *name = mymalloc(strlen(outname)+(addrbits+3)/4+2);
+  FILE *f;
+
+  sprintf(name,"%s.%0*llx",outname,(addrbits+3)/4,
+          (unsigned long long)(utaddr)s->org);
+  if ((f = fopen(name,"wb")) == NULL)
+    general_error(13,name);  /* could not open for output */
+  myfree(name);
+  return f;
+}
+
+
 static void write_output(FILE *f,section *sec,symbol *sym)
 {
+  FILE *mainf = f;
   section *s,**seclist,**slp;
   unsigned long long pc=0,npc;
   size_t nsecs;
@@ -175,12 +226,6 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   for (slp=seclist; nsecs>0; nsecs--) {
     s = *slp++;
 
-    /* strip uninitialized space atoms from section */
-    if (s->last)
-      s->last->next = NULL;
-    else
-      s->first = NULL;
-
     /* write optional section header or pad to next section start */
     switch (binfmt) {
       case BINFMT_ATARICOM:
@@ -218,14 +263,24 @@ static void write_output(FILE *f,section *sec,symbol *sym)
         break;
 
       default:
+        if (s == seclist[0])
+          break;
+        if (splitsecs && binfmt==BINFMT_RAW) {
+          /* every further section is written into its own file */
+          if (f != mainf)
+            fclose(f);
+          if ((f = open_split_file(s)) == NULL)
+            return;
+        }
         /* fill gap between sections with pad-bytes */
-        if (!coalesce && s!=seclist[0] && ((unsigned long long)s->org) > pc)
-          fwpattern(f,((unsigned long long)s->org)-pc,s->pad,s->padbytes);
+        else if (!coalesce && ((unsigned long long)s->org) > pc)
+          fwgap(f,s,((unsigned long long)s->org)-pc);
         break;
     }
 
-    /* write section contents */
-    for (p=s->first,pc=(unsigned long long)s->org; p; p=p->next) {
+    /* write section contents, without trailing uninitialized space atoms */
+    for (p=s->last?s->first:NULL,pc=(unsigned long long)s->org; p;
+         p=p!=s->last?p->next:NULL) {
       npc = fwpcalign(f,p,s,pc);
 
       if (p->type == DATA)
@@ -237,6 +292,11 @@ static void write_output(FILE *f,section *sec,symbol *sym)
     }
   }
 
+  if (f != mainf) {
+    fclose(f);
+    f = mainf;
+  }
+
   /* patch the header or write trailer */
   switch (binfmt) {
     case BINFMT_APPLEBIN:
@@ -291,6 +351,14 @@ static int output_args(char *p)
     coalesce = 1;
     return 1;
   }
+  else if (!strcmp(p,"-sparse")) {
+    sparse = 1;
+    return 1;
+  }
+  else if (!strcmp(p,"-split")) {
+    splitsecs = 1;
+    return 1;
+  }
   else if (!strcmp(p,"-join")) {
     joinsecs = 1;
     return 1;
@@ -18,7 +18,7 @@
 #define REC_ELA 4 /* extended linear address */
 #define REC_SLA 5 /* start linear address */
 
-static char *copyright = "vasm Intel HEX output module 0.3 (c) 2020 Rida Dzhaafar";
+static char *copyright = "vasm Intel HEX output module 0.4 (c) 2020 Rida Dzhaafar";
 
 static int ihex_fmt = I8HEX; /* default ihex format */
 
@@ -26,6 +26,10 @@ static uint8_t *buffer;       /* output buffer for data records */
 static uint8_t buffer_s = 32; /* maximum buffer size */
 static uint8_t buffer_i = 0;  /* current index in buffer */
 
+/* a data record is formatted here before writing it in one go:
+   ':', count, address, type, up to 255 data bytes, checksum, CR/LF */
+static char line[1+2*(4+255+1)+2];
+
 static uint32_t addr = 0;     /* current output address */
 static uint16_t ext_addr = 0; /* last written extended segment/linear address */
 
@@ -66,10 +70,12 @@ static void write_extended_record(FILE *f)
 
 static void write_data_record(FILE *f)
 {
+  uint8_t hdr[4];
   uint8_t csum;
   uint8_t i;
   uint16_t ext;
   uint32_t start;
+  char *p;
 
   /* pre-flight checks */
   if (buffer_i == 0)
@@ -90,18 +96,24 @@ static void write_data_record(FILE *f)
     write_extended_record(f);
   }
 
-  /* write data record */
-  fprintf(f, ":%02X%04X00", buffer_i, start);
-  csum = start;
-  csum += start >> 8;
-  csum += buffer_i;
-  for (i = 0; i < buffer_i; i++) {
+  /* format the whole data record into the line buffer and write it */
+  p = line;
+  *p++ = ':';
+  hdr[0] = buffer_i;
+  hdr[1] = start >> 8;
+  hdr[2] = start;
+  hdr[3] = REC_DAT;
+  p = hexbytes(p, hdr, 4);
+  p = hexbytes(p, buffer, buffer_i);
+  csum = hdr[0] + hdr[1] + hdr[2];
+  for (i = 0; i < buffer_i; i++)
     csum += buffer[i];
-    fprintf(f, "%02X", buffer[i]);
-  }
   csum = (~csum) + 1;
-  fprintf(f, "%02X", csum);
-  write_newline(f);
+  p = hexbytes(p, &csum, 1);
+  if (!asciiout)
+    *p++ = '\r';
+  *p++ = '\n';
+  fwdata(f, line, p - line);
 
   /* reset the buffer index */
   buffer_i = 0;
@@ -128,6 +140,30 @@ static void buffer_byte(FILE *f, void *byte)
     for (i = 0; i < octetsperbyte; buffer_data(f, p[i++]));
 }
 
+static void buffer_bytes(FILE *f, uint8_t *p, size_t n)
+/* put n target bytes into the buffer, copying as much as fits at once */
+{
+  size_t len;
+
+  if (output_bytes_le && octetsperbyte > 1) {
+    for (; n > 0; n--, p += octetsperbyte)
+      buffer_byte(f, p);
+    return;
+  }
+
+  for (n = OCTETS(n); n > 0; n -= len) {
+    len = buffer_s - buffer_i;
+    if (len > n)
+      len = n;
+    memcpy(buffer + buffer_i, p, len);
+    buffer_i += len;
+    addr += len;
+    p += len;
+    if (buffer_i == buffer_s)
+      write_data_record(f);
+  }
+}
+
 /* align the atom if necessary
    adapted from support.c fwpcalign/fwpattern */
 static taddr mypcalign(FILE *f, section *sec, atom *a, taddr pc)
@@ -175,7 +211,7 @@ static taddr mypcalign(FILE *f, section *sec, atom *a, taddr pc)
 
 static void write_output(FILE *f, section *sec, symbol *sym)
 {
-  int i, j;
+  size_t i;
   taddr pc;
   atom *a;
   section *s;
@@ -197,14 +233,12 @@ static void write_output(FILE *f, section *sec, symbol *sym)
     for (a = s->first; a; a = a->next) {
       pc = mypcalign(f, s, a, pc);
       if (a->type == DATA) {
-        for (i = 0; i < a->content.db->size; i++,pc++) {
-          buffer_byte(f, a->content.db->data+OCTETS(i));
-        }
+        buffer_bytes(f, a->content.db->data, a->content.db->size);
+        pc += a->content.db->size;
       } else if (a->type == SPACE) {
         for (i = 0; i < a->content.sb->space; i++) {
-          for (j = 0; j < a->content.sb->size; j++,pc++) {
-            buffer_byte(f, a->content.sb->fill+OCTETS(j));
-          }
+          buffer_bytes(f, a->content.sb->fill, a->content.sb->size);
+          pc += a->content.sb->size;
         }
       }
     }
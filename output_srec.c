@@ -16,10 +16,18 @@ likely need to be converted to ASCII to use it elsewhere.
 #include "vasm.h"
 
 #ifdef OUTSREC
-static char *copyright="vasm motorola srecord output module 2.0 (c) 2015 Joseph Zatarski";
+static char *copyright="vasm motorola srecord output module 2.1 (c) 2015 Joseph Zatarski";
 
-static uint8_t data[32];  /* acts as a buffer for data portion of a record */
+#define MAXRECDATA 250  /* max. data bytes fitting into any record type */
+#define MAXHDRNAME 32   /* max. section name bytes in an S0 header */
+
+static uint8_t data[MAXRECDATA];  /* buffer for data portion of a record */
 static size_t data_size;  /* indicates current size of data[] */
+static size_t rec_size = 32;  /* data bytes per record, -record-size */
+
+/* a complete record is formatted here before writing it in one go:
+   'S', type, count, up to 4 address bytes, data, checksum, CR/LF */
+static char line[2+2*(1+4+MAXRECDATA+1)+2];
 
 /*
  * holds address for the current record
@@ -51,26 +59,46 @@ static char *start_sym; /* points to name of the start symbol, or NULL if not
 static char *default_start="start"; /* name of default execution address symbol
                                        for termination record */
 
-/* gbm modifications 06'21 */
-static void write_newline(FILE *f)
-{
-  if (!asciiout)
-    fw8(f, '\r');
-  fw8(f, '\n');
-}
 
-static char tohex(uint8_t v)
+static void write_record(FILE *f, int type, int addrbytes,
+                         unsigned long long addr, uint8_t *d, size_t n)
+/*
+ * formats a complete record of the given type with an address field of
+ * addrbytes bytes and n data bytes into line[] and writes it at once
+ */
 {
-  return "0123456789ABCDEF"[v & 0xf];
-}
+  uint8_t abuf[4];
+  uint8_t checksum;
+  char *p = line;
+  int i;
 
-static void write_hex_byte(FILE *f, uint8_t byte)
-/* write a pair of ASCII characters to represent the byte in hex */
-{
-  fw8(f, tohex(byte >> 4));
-  fw8(f, tohex(byte));
+  *p++ = 'S';
+  *p++ = type + '0';
+  checksum = n + addrbytes + 1;  /* count: address, data and checksum */
+  p = hexbytes(p, &checksum, 1);
+
+  for (i = addrbytes - 1; i >= 0; i--)
+  {
+    abuf[i] = addr & 0xff;
+    addr >>= 8;
+  }
+  p = hexbytes(p, abuf, addrbytes);
+  for (i = 0; i < addrbytes; i++)
+    checksum += abuf[i];
+
+  p = hexbytes(p, d, n);
+  while (n--)
+    checksum += *d++;
+
+  checksum ^= 0xff;
+  p = hexbytes(p, &checksum, 1);
+
+  /* gbm modifications 06'21 */
+  if (!asciiout)
+    *p++ = '\r';
+  *p++ = '\n';
+  fwdata(f, line, p - line);
 }
-/* end of gbm mods */
 
 
 static void write_data_buffer(FILE *f, uint8_t type)
@@ -81,9 +109,6 @@ static void write_data_buffer(FILE *f, uint8_t type)
  * types, although that should never happen.
  */
 {
-  uint8_t checksum;
-  int i;
-  
   if(data_size == 0 && type != 0) /* allow S0 record to have data size of 0 */
     return; /* nothing to write */
 
@@ -94,49 +119,11 @@ static void write_data_buffer(FILE *f, uint8_t type)
   if(type > 3)
     return; /* ignore types we don't handle, but this shouldn't ever happen */
 
-  fw8(f, 'S');
-  fw8(f, type + '0');
-  
-  checksum = data_size + 2 + (type ? type : 1);  /* at least 2 byte address */
-
-  write_hex_byte(f, checksum); /* count: 4 bytes for address + checksum */
-
-  if(type > 2)
-  {
-    uint8_t b = srec_pc >> 24;
-    write_hex_byte(f, b);
-    checksum += b;
-  }
-  if(type > 1)
-  {
-    uint8_t b = srec_pc >> 16;
-    write_hex_byte(f, b);
-    checksum += b;
-  }
   if(type > 0)
-  {
-    uint8_t b = srec_pc >> 8;
-    write_hex_byte(f, b);
-    checksum += b;
-    write_hex_byte(f, srec_pc & 0xff);
-    checksum += srec_pc & 0xff;
-  }  
-  else /* type must be 0 */
-  {
-    write_hex_byte(f, 0);
-    write_hex_byte(f, 0);
-  }
-  
-  for(i = 0; i < data_size; i++)
-  {
-    write_hex_byte(f, data[i]);
-    checksum += data[i];
-  }
-  
-  write_hex_byte(f, checksum ^ 0xff);
+    write_record(f, type, type + 1, srec_pc, data, data_size);
+  else /* header has a 2 byte zero address */
+    write_record(f, 0, 2, 0, data, data_size);
 
-  write_newline(f);
-  
   srec_pc += data_size;
   data_size = 0;
 }
@@ -145,60 +132,21 @@ static void write_termination_record(FILE *f)
 /* writes termination record, S7/8/9 depending on whether we're in S19/S28/S37
  * mode */
 {
-  uint8_t checksum = 0;
-  
   /* check if address is out of range for this record type and error */
   if(srecfmt > 0 && ((start_addr >> ((srecfmt + 1) * 8)) != 0))
     output_error(11, start_addr);
   
-  fw8(f, 'S');
-  fw8(f, (10 - srecfmt) + '0'); /* writes S header depending on S19/S28/S37 */
-  
-  if(srecfmt == S37)
-  {
-    write_hex_byte(f, 5); /* count: 4 bytes for address + checksum */
-    checksum += 5;
-  
-  }
-  else if(srecfmt == S28)
-  {
-    write_hex_byte(f, 4); /* count: 3 bytes for address + checksum */
-    checksum += 4;
-  }
-  else if(srecfmt == S19)
-  {
-    write_hex_byte(f, 3); /* count: 2 bytes for address + checksum */
-    checksum += 3;
-  }
-
-  if(srecfmt >= S37)
-  {
-    write_hex_byte(f, (start_addr & 0xff000000) >> 24);
-    checksum += (start_addr & 0xff000000) >> 24;
-  }  
-  if(srecfmt >= S28)
-  {
-    write_hex_byte(f, (start_addr & 0xff0000) >> 16);
-    checksum += (start_addr & 0xff0000) >> 16;
-  }  
-  write_hex_byte(f, (start_addr & 0xff00) >> 8);
-  checksum += (start_addr & 0xff00) >> 8;
-  write_hex_byte(f, start_addr & 0xff);
-  checksum += start_addr & 0xff;
-
-  write_hex_byte(f, checksum ^ 0xff);
-
-  write_newline(f);
+  /* writes S header depending on S19/S28/S37 */
+  write_record(f, 10 - srecfmt, srecfmt + 1, start_addr, NULL, 0);
 }
 
 static void put_byte_in_buffer(FILE *f, uint8_t byte)
 /* puts a byte in the data buffer and flushes the buffer if we fill it up */
-/* also updates pc */
 {
   data[data_size] = byte;
   data_size++;
   
-  if(data_size >= 32)
+  if(data_size >= rec_size)
     write_data_buffer(f, srecfmt);
 }
 
@@ -215,6 +163,33 @@ static void put_tbyte_in_buffer(FILE *f, void *tbyte)
   pc++;
 }
 
+static void put_data_in_buffer(FILE *f, uint8_t *p, size_t n)
+/* puts n target bytes into the data buffer, copying as much as fits */
+/* into the current record at once */
+{
+  size_t len;
+
+  if (output_bytes_le && octetsperbyte > 1)
+  {
+    for (; n > 0; n--, p += octetsperbyte)
+      put_tbyte_in_buffer(f, p);
+    return;
+  }
+
+  pc += n;
+  for (n = OCTETS(n); n > 0; n -= len)
+  {
+    len = rec_size - data_size;
+    if (len > n)
+      len = n;
+    memcpy(data + data_size, p, len);
+    data_size += len;
+    p += len;
+    if(data_size >= rec_size)
+      write_data_buffer(f, srecfmt);
+  }
+}
+
 static void addralign(FILE *f,atom *a,section *sec)
 /* modified from fwpcalign() in supp.c */
 {
@@ -261,7 +236,7 @@ static void write_output(FILE *f,section *sec,symbol *sym)
 {
   section *s;
   atom *p;
-  unsigned long long i, j;
+  unsigned long long i;
 
   if (!sec)
     return;
@@ -282,7 +257,7 @@ static void write_output(FILE *f,section *sec,symbol *sym)
 
   for (s=sec; s!=NULL; s=s->next)	/* iterate through sections */
   {
-    for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < 32); data_size++)
+    for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < MAXHDRNAME); data_size++)
     /* loop loads name of section into data and sets data_size properly */
     {
       data[data_size] = *(s->name + data_size);
@@ -295,17 +270,11 @@ static void write_output(FILE *f,section *sec,symbol *sym)
     {
       addralign(f,p,s);
       if(p->type == DATA)
-        for (i = 0; i < p->content.db->size; i++)
-          put_tbyte_in_buffer(f,p->content.db->data+OCTETS(i));
+        put_data_in_buffer(f,p->content.db->data,p->content.db->size);
       else if (p->type == SPACE)
       {
         for (i = 0; i < p->content.sb->space; i++)
-        {
-          for (j = 0; j < p->content.sb->size; j++)
-          {
-            put_tbyte_in_buffer(f,p->content.sb->fill+OCTETS(j));
-          }
-        }
+          put_data_in_buffer(f,p->content.sb->fill,p->content.sb->size);
       } 
     }
     
@@ -353,6 +322,16 @@ static int output_args(char *p)
     asciiout = 0;
     return 1;
   }
+
+  else if (!strncmp(p, "-record-size=", 13))
+  {
+    int size = atoi(p + 13);
+
+    if (size < 1 || size > MAXRECDATA)
+      return 0;
+    rec_size = size;
+    return 1;
+  }
   return 0;	
 }
 
@@ -456,10 +456,7 @@ static void list_skipped_line(char *p)
 
   if (len>0 && (*(p-1)=='\n' || *(p-1)=='\r'))
     len--;
-  if (len >= MAXLISTSRC)
-    len = MAXLISTSRC - 1;
-  memcpy(new->txt,cur_src->srcptr,len);
-  new->txt[len] = '\0';
+  set_listing_text(new,cur_src->srcptr,len,0);
 }
 
 
@@ -1055,8 +1052,9 @@ section *find_structure(char *name,int name_len)
 /* reads the next input line */
 char *read_next_line(void)
 {
-  char *s,*srcend,*d;
+  char *s,*srcend,*d,*start;
   int nparam,len;
+  int expanded = 0;
   int skip_listing = 0;
   char *rept_end = NULL;
 
@@ -1194,7 +1192,9 @@ char *read_next_line(void)
     nparam = 0;  /* expand current repeat-iterator symbol into source */
 
   /* copy next line to linebuf */
+  for (start=s; start<srcend && *start=='\r'; start++);
   while (s<srcend && *s!='\0') {
+    char *olds = s;
     int nc;
 
     if (nparam >= 0)
@@ -1202,6 +1202,8 @@ char *read_next_line(void)
     else
       nc = 0;
 
+    if (nc>=0 && s!=olds)
+      expanded = 1;  /* macro argument consumed, even when it was empty */
     if (nc > 0) {
       /* expanded macro arguments */
       len -= nc;
@@ -1254,8 +1256,11 @@ char *read_next_line(void)
   if (listena && !skip_listing) {
     listing *new = new_listing(cur_src,cur_src->line);
 
-    strncpy(new->txt,s,MAXLISTSRC);
-    new->txt[MAXLISTSRC-1] = '\0';
+    /* refer to the source text, unless the line was modified */
+    if (expanded)
+      set_listing_text(new,s,d-s,1);
+    else
+      set_listing_text(new,start,d-s,0);
   }
   if (rept_end)
     start_repeat(rept_end);
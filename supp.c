@@ -546,6 +546,31 @@ taddr fwpcalign(FILE *f,atom *a,section *sec,taddr pc)
 }
 
 
+char *hexbytes(char *p,const uint8_t *d,size_t n)
+/* write n bytes from d as pairs of upper case hex digits to p,
+   returns the pointer behind the last digit written */
+{
+  static char hexpair[256][2];
+  uint8_t b;
+
+  if (hexpair[1][1] == 0) {  /* first call: init lookup table */
+    static const char hexdigits[] = "0123456789ABCDEF";
+    int i;
+
+    for (i=0; i<256; i++) {
+      hexpair[i][0] = hexdigits[i>>4];
+      hexpair[i][1] = hexdigits[i&15];
+    }
+  }
+  while (n--) {
+    b = *d++;
+    *p++ = hexpair[b][0];
+    *p++ = hexpair[b][1];
+  }
+  return p;
+}
+
+
 size_t filesize(FILE *fp)
 /* @@@ Warning! filesize() only works reliably on binary streams! @@@ */
 {
@@ -65,6 +65,7 @@ void fwalign(FILE *,taddr,taddr);
 int fwpattern(FILE *,taddr,uint8_t *,int);
 taddr fwpcalign(FILE *,atom *,section *,taddr);
 size_t filesize(FILE *);
+char *hexbytes(char *,const uint8_t *,size_t);
 
 int stricmp(const char *,const char *);
 int strnicmp(const char *,const char *,size_t);
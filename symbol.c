@@ -7,6 +7,7 @@
 symbol *first_symbol;
 
 static symbol *saved_symbol;
+static symbol *undone_symbols;
 static const char *last_global_label=emptystr;
 
 #ifndef SYMHTABSIZE
@@ -14,6 +15,37 @@ static const char *last_global_label=emptystr;
 #endif
 static hashtable *symhash;
 
+/* Local symbols (" global local") are not entered into symhash, but into
+   a separate table per global label scope, which is created on demand. */
+typedef struct symscope {
+  char *name;           /* name of the global label defining the scope */
+  int len;
+  size_t nlocals;
+  hashtable *locals;    /* local symbols, hashed by their local name */
+} symscope;
+
+#ifndef SCOPEHTABSIZE
+#define SCOPEHTABSIZE 0x1000
+#endif
+#ifndef LOCHTABSIZE
+#define LOCHTABSIZE 0x10
+#endif
+static hashtable *scopehash;
+static symscope *last_scope;  /* most recently used scope, checked first */
+
+/* Symbols are allocated from slabs and their names from a string pool,
+   to avoid the overhead of many small allocations. */
+#ifndef SYMSLABSIZE
+#define SYMSLABSIZE 0x400
+#endif
+#ifndef NAMEPOOLSIZE
+#define NAMEPOOLSIZE 0x10000
+#endif
+static symbol *symslab,*free_symbols;
+static size_t symslab_left;
+static char *namepool;
+static size_t namepool_left;
+
 #ifdef HAVE_REGSYMS
 static hashtable *regsymhash;
 #endif
@@ -99,32 +131,216 @@ const char *get_bind_name(symbol *p)
 }
 
 
-void add_symbol(symbol *p)
+symbol *alloc_symbol(void)
+{
+  symbol *sym;
+
+  if (sym = free_symbols)
+    free_symbols = sym->next;
+  else {
+    if (symslab_left == 0) {
+      symslab = mymalloc(SYMSLABSIZE*sizeof(symbol));
+      symslab_left = SYMSLABSIZE;
+    }
+    sym = symslab++;
+    symslab_left--;
+  }
+  return sym;
+}
+
+
+static void free_symbol(symbol *sym)
+{
+  sym->next = free_symbols;
+  free_symbols = sym;
+}
+
+
+char *alloc_symname(size_t size)
+/* allocate space for a symbol name, which is never freed */
+{
+  char *p;
+
+  if (size > NAMEPOOLSIZE/16)
+    return mymalloc(size);
+  if (size > namepool_left) {
+    namepool = mymalloc(NAMEPOOLSIZE);
+    namepool_left = NAMEPOOLSIZE;
+  }
+  p = namepool;
+  namepool += size;
+  namepool_left -= size;
+  return p;
+}
+
+
+static const char *dup_symname(const char *name)
+{
+  size_t size = strlen(name) + 1;
+
+  return memcpy(alloc_symname(size),name,size);
+}
+
+
+static const char *split_local(const char *name,int *glen)
+/* return local part of a local symbol name and the length of its global
+   part, or NULL when the name is not local */
+{
+  const char *p;
+
+  if (*name!=' ' || (p = strchr(name+1,' ')) == NULL)
+    return NULL;
+  *glen = p - (name + 1);
+  return p + 1;
+}
+
+
+static symscope *find_scope(const char *glob,int glen,int create)
 {
+  symscope *sc = last_scope;
   hashdata data;
 
+  if (sc!=NULL && sc->len==glen &&
+      !(nocase ? strnicmp(sc->name,glob,glen) : strncmp(sc->name,glob,glen)))
+    return sc;
+
+  if (find_namelen(scopehash,glob,glen,&data))
+    sc = data.ptr;
+  else if (create) {
+    sc = mymalloc(sizeof(*sc));
+    sc->name = mymalloc(glen+1);
+    memcpy(sc->name,glob,glen);
+    sc->name[glen] = '\0';
+    sc->len = glen;
+    sc->nlocals = 0;
+    sc->locals = new_hashtable(LOCHTABSIZE);
+    data.ptr = sc;
+    add_hashentry(scopehash,sc->name,data);
+  }
+  else
+    return NULL;
+
+  return last_scope = sc;
+}
+
+
+static void add_symname(const char *name,symbol *sym,hashentry *e)
+/* enter symbol into the hash table under name, using entry e, if given */
+{
+  hashtable *ht;
+  const char *loc;
+  int glen;
+
+  if (loc = split_local(name,&glen)) {
+    symscope *sc = find_scope(name+1,glen,1);
+
+    if (++sc->nlocals > 2*sc->locals->size)
+      resize_hashtable(sc->locals,4*sc->locals->size);
+    ht = sc->locals;
+    name = loc;
+  }
+  else
+    ht = symhash;
+
+  if (e) {
+    e->name = name;
+    e->data.ptr = sym;
+    link_hashentry(ht,e);
+  }
+  else {
+    hashdata data;
+
+    data.ptr = sym;
+    add_hashentry(ht,name,data);
+  }
+}
+
+
+static void rem_symname(symbol *sym)
+{
+  const char *loc;
+  int glen;
+
+  if (loc = split_local(sym->name,&glen)) {
+    symscope *sc = find_scope(sym->name+1,glen,0);
+
+    if (sc == NULL)
+      ierror(0);
+    unlink_hashentry(sc->locals,&sym->hent);
+    if (--sc->nlocals == 0) {
+      /* release the scope together with its last local symbol */
+      rem_hashentry(scopehash,sc->name,nocase);
+      if (last_scope == sc)
+        last_scope = NULL;
+      myfree(sc->locals->entries);
+      myfree(sc->locals);
+      myfree(sc->name);
+      myfree(sc);
+    }
+  }
+  else
+    unlink_hashentry(symhash,&sym->hent);
+}
+
+
+static void free_undone(symbol *sym)
+{
+  rem_symname(sym);
+  free_symbol(sym);
+}
+
+
+void add_symbol(symbol *p)
+{
+  if (undone_symbols) {
+    /* an undone symbol with the same name must not stay in the table */
+    symbol **pp,*sym;
+
+    for (pp=&undone_symbols; sym=*pp; pp=&sym->next) {
+      if (!(nocase ? stricmp(sym->name,p->name) : strcmp(sym->name,p->name))) {
+        *pp = sym->next;
+        free_undone(sym);
+        break;
+      }
+    }
+  }
   p->next = first_symbol;
   first_symbol = p;
-  data.ptr = p;
-  add_hashentry(symhash,p->name,data);
+  add_symname(p->name,p,&p->hent);
 }
 
 
-symbol *find_symbol(const char *name)
+static symbol *lookup_symbol(const char *name)
+/* find symbol in the hash tables, including those which were undone */
 {
   hashdata data;
-  if (!find_name(symhash,name,&data))
+  const char *loc;
+  int glen;
+
+  if (loc = split_local(name,&glen)) {
+    symscope *sc = find_scope(name+1,glen,0);
+
+    if (sc==NULL || !find_name(sc->locals,loc,&data))
+      return 0;
+  }
+  else if (!find_name(symhash,name,&data))
     return 0;
   return data.ptr;
 }
 
 
+symbol *find_symbol(const char *name)
+{
+  symbol *sym = lookup_symbol(name);
+
+  return sym!=NULL && !(sym->flags & UNDONE) ? sym : NULL;
+}
+
+
 void refer_symbol(symbol *sym,const char *refname)
 /* refer to an existing symbol with an additional name */
 {
-  hashdata data;
-  data.ptr=sym;
-  add_hashentry(symhash,refname,data);
+  add_symname(refname,sym,NULL);
 }
 
 
@@ -153,9 +369,11 @@ void restore_symbols(void)
           lastprot = symp;
       }
       else {
-        rem_hashentry(symhash,symp->name,nocase);
-        myfree((void *)symp->name);
-        myfree(symp);
+        /* Hide it, but keep it in the hash table for reuse by another
+           operand parsing attempt, until commit_symbols() is called. */
+        symp->flags |= UNDONE;
+        symp->next = undone_symbols;
+        undone_symbols = symp;
       }
     }
     if (firstprot) {
@@ -168,6 +386,18 @@ void restore_symbols(void)
 }
 
 
+void commit_symbols(void)
+/* finally delete all symbols removed by restore_symbols() */
+{
+  symbol *symp;
+
+  while (symp = undone_symbols) {
+    undone_symbols = symp->next;
+    free_undone(symp);
+  }
+}
+
+
 int check_symbol(const char *name)
 /* issue an error when symbol is already defined in the current source */
 {
@@ -248,8 +478,8 @@ symbol *new_abs(const char *name,expr *tree)
     add=0;
   }
   else {
-    new = mymalloc(sizeof(*new));
-    new->name = mystrdup(name);
+    new = alloc_symbol();
+    new->name = dup_symname(name);
     add = 1;
   }
 
@@ -280,20 +510,30 @@ symbol *new_equate(const char *name,expr *tree)
 
 symbol *new_import(const char *name)
 {
-  symbol *new = find_symbol(name);
+  symbol *new = lookup_symbol(name);
 
-  if (new)
-    return new;
-
-  new = mymalloc(sizeof(*new));
+  if (new) {
+    symbol **pp;
+
+    if (!(new->flags & UNDONE))
+      return new;
+    /* revive an undone symbol, instead of creating it again */
+    for (pp=&undone_symbols; *pp!=new; pp=&(*pp)->next);
+    *pp = new->next;
+    new->next = first_symbol;
+    first_symbol = new;
+  }
+  else {
+    new = alloc_symbol();
+    new->name = dup_symname(name);
+    add_symbol(new);
+  }
   new->type = IMPORT;
   new->flags = 0;
-  new->name = mystrdup(name);
   new->sec = 0;
   new->pc = 0;
   new->size = 0;
   new->align = 0;
-  add_symbol(new);
   return new;
 }
 
@@ -344,15 +584,15 @@ symbol *new_labsym(section *sec,const char *name)
     else {
       symbol *old = new;
 
-      new = mymalloc(sizeof(*new));
+      new = alloc_symbol();
       *new = *old;
       general_error(74,name);  /* label redefined (error) */
     }
     add = 0;
   }
   else {
-    new = mymalloc(sizeof(*new));
-    new->name = mystrdup(name);
+    new = alloc_symbol();
+    new->name = dup_symname(name);
     add = 1;
   }
 
@@ -509,6 +749,7 @@ int undef_regsym(const char *name,int no_case,int type)
 int init_symbol(void)
 {
   symhash = new_hashtable(SYMHTABSIZE);
+  scopehash = new_hashtable(SCOPEHTABSIZE);
 #ifdef HAVE_REGSYMS
   regsymhash = new_hashtable(REGSYMHTSIZE);
 #endif
@@ -521,6 +762,8 @@ void exit_symbol(void)
   if (debug) {
     if (symhash->collisions)
       fprintf(stderr,"*** %d symbol collisions!!\n",symhash->collisions);
+    if (scopehash->collisions)
+      fprintf(stderr,"*** %d local scope collisions!!\n",scopehash->collisions);
 #ifdef HAVE_REGSYMS
     if (regsymhash->collisions)
       fprintf(stderr,"*** %d register symbol collisions!!\n",regsymhash->collisions);
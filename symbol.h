@@ -34,6 +34,7 @@
 #define NEAR (1<<15)        /* may refer symbol with near addressing modes */
 #define XDEF (1<<16)        /* must not remain at IMPORT-type */
 #define XREF (1<<17)        /* must stay IMPORT-type */
+#define UNDONE (1<<18)      /* removed by restore_symbols(), may be reused */
 #define RSRVD_C (1L<<20)    /* bits 20..23 are reserved for cpu modules */
 #define RSRVD_S (1L<<24)    /* bits 24..27 are reserved for syntax modules */
 #define RSRVD_O (1L<<28)    /* bits 28..31 are reserved for output modules */
@@ -49,6 +50,7 @@ struct symbol {
   taddr pc;
   taddr align;
   unsigned long idx; /* usable by output module */
+  hashentry hent;    /* entry in the symbol hash table */
 };
 
 /* type of symbol references */
@@ -71,11 +73,14 @@ extern symbol *first_symbol;
 
 void print_symbol(FILE *,symbol *);
 const char *get_bind_name(symbol *);
+symbol *alloc_symbol(void);
+char *alloc_symname(size_t);
 void add_symbol(symbol *);
 symbol *find_symbol(const char *);
 void refer_symbol(symbol *,const char *);
 void save_symbols(void);
 void restore_symbols(void);
+void commit_symbols(void);
 
 int check_symbol(const char *);
 const char *set_last_global_label(const char *);
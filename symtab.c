@@ -56,13 +56,35 @@ size_t hashcodelen_nc(const char *name,int len)
   return h;
 }
 
-/* add to hashtable; name must be unique */
-void add_hashentry(hashtable *ht,const char *name,hashdata data)
+/* change number of hash buckets, keeping all entries */
+void resize_hashtable(hashtable *ht,size_t size)
 {
-  size_t i=nocase?(hashcode_nc(name)%ht->size):(hashcode(name)%ht->size);
-  hashentry *new=mymalloc(sizeof(*new));
-  new->name=name;
-  new->data=data;
+  hashentry **old=ht->entries,*p,*next;
+  size_t i,n=ht->size,h;
+
+#ifdef LOWMEM
+  if (size > 0x100)
+    size = 0x100;
+#endif
+  if (size == n)
+    return;
+  ht->entries=mycalloc(size*sizeof(*ht->entries));
+  ht->size=size;
+  for(i=0;i<n;i++){
+    for(p=old[i];p;p=next){
+      next=p->next;
+      h=nocase?(hashcode_nc(p->name)%size):(hashcode(p->name)%size);
+      p->next=ht->entries[h];
+      ht->entries[h]=p;
+    }
+  }
+  myfree(old);
+}
+
+/* add preallocated entry to hashtable; name must be unique */
+void link_hashentry(hashtable *ht,hashentry *new)
+{
+  size_t i=nocase?(hashcode_nc(new->name)%ht->size):(hashcode(new->name)%ht->size);
   if(debug){
     if(ht->entries[i])
       ht->collisions++;
@@ -71,6 +93,30 @@ void add_hashentry(hashtable *ht,const char *name,hashdata data)
   ht->entries[i]=new;
 }
 
+/* add to hashtable; name must be unique */
+void add_hashentry(hashtable *ht,const char *name,hashdata data)
+{
+  hashentry *new=mymalloc(sizeof(*new));
+  new->name=name;
+  new->data=data;
+  link_hashentry(ht,new);
+}
+
+/* remove preallocated entry from hashtable, without freeing it */
+void unlink_hashentry(hashtable *ht,hashentry *e)
+{
+  size_t i=nocase?(hashcode_nc(e->name)%ht->size):(hashcode(e->name)%ht->size);
+  hashentry **pp;
+
+  for(pp=&ht->entries[i];*pp;pp=&(*pp)->next){
+    if(*pp==e){
+      *pp=e->next;
+      return;
+    }
+  }
+  ierror(0);
+}
+
 /* remove from hashtable; name must be unique */
 void rem_hashentry(hashtable *ht,const char *name,int no_case)
 {
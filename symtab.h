@@ -21,11 +21,14 @@ typedef struct hashtable {
 } hashtable;
 
 hashtable *new_hashtable(size_t);
+void resize_hashtable(hashtable *,size_t);
 size_t hashcode(const char *);
 size_t hashcodelen(const char *,int);
 size_t hashcode_nc(const char *);
 size_t hashcodelen_nc(const char *,int);
+void link_hashentry(hashtable *,hashentry *);
 void add_hashentry(hashtable *,const char *,hashdata);
+void unlink_hashentry(hashtable *,hashentry *);
 void rem_hashentry(hashtable *,const char *,int);
 int find_name(hashtable *,const char *,hashdata *);
 int find_namelen(hashtable *,const char *,int,hashdata *);
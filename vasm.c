@@ -63,6 +63,10 @@ char vasmsym_name[]="__VASM";
 static FILE *outfile;
 static int maxpasses=MAXPASSES;
 static section *first_section,*last_section;
+#define SECHTSIZE 0x100
+static section **sechash;
+static size_t sechashsize;
+static int nsections;
 #if NOT_NEEDED
 static section *prev_sec,*prev_org;
 #endif
@@ -83,6 +87,19 @@ static char *output_copyright;
 static void (*write_object)(FILE *,section *,symbol *);
 static int (*output_args)(char *);
 
+/* additional output modules, each selected by another -F<fmt> option */
+#define MAXOUTMODS 8
+static struct outmod {
+  char *format;
+  char *name;
+  char *copyright;
+  void (*write_object)(FILE *,section *,symbol *);
+  int (*output_args)(char *);
+  int argidx;       /* index of the -F option in argv[] */
+  int asciiout;
+} outmods[MAXOUTMODS];
+static int num_outmods;
+
 
 void leave(void)
 {
@@ -115,6 +132,52 @@ void leave(void)
     exit(EXIT_SUCCESS);
 }
 
+/* Enter a new section into the name hash table. Sections with the same
+   name (but different attributes) are kept in creation order, so
+   find_section() still returns the first one defined. */
+static void hash_section(section *sec)
+{
+  section **p;
+
+  if(!sechash){
+    sechashsize=SECHTSIZE;
+    sechash=mycalloc(sechashsize*sizeof(section *));
+  }
+  else if(nsections>=2*sechashsize){
+    /* grow the table and rehash all sections in list order */
+    section *s;
+
+    myfree(sechash);
+    sechashsize*=4;
+    sechash=mycalloc(sechashsize*sizeof(section *));
+    for(s=first_section;s;s=s->next){
+      if(s!=sec){
+        for(p=&sechash[hashcode(s->name)&(sechashsize-1)];*p;p=&(*p)->hnext);
+        *p=s;
+        s->hnext=NULL;
+      }
+    }
+  }
+  for(p=&sechash[hashcode(sec->name)&(sechashsize-1)];*p;p=&(*p)->hnext);
+  *p=sec;
+  sec->hnext=NULL;
+  nsections++;
+}
+
+static void unhash_section(section *sec)
+{
+  section **p;
+
+  for(p=&sechash[hashcode(sec->name)&(sechashsize-1)];*p;p=&(*p)->hnext){
+    if(*p==sec){
+      *p=sec->hnext;
+      nsections--;
+      return;
+    }
+  }
+  ierror(0);
+}
+
 /* Convert all labels from an offset-section into absolute expressions. */
 static void convert_offset_labels(void)
 {
@@ -136,6 +199,7 @@ static void remove_unalloc_sects(void)
 
   for (sec=first_section,prev=NULL; sec; sec=sec->next) {
     if (sec->flags&UNALLOCATED) {
+      unhash_section(sec);
       if (prev)
         prev->next = sec->next;
       else
@@ -281,6 +345,7 @@ static int resolve_section(section *sec)
 #if HAVE_CPU_OPTS
       if(p->type==OPTS){
         cpu_opts(p->content.opts);
+        new_eval_epoch();
       }
       else
 #endif
@@ -300,12 +365,20 @@ static int resolve_section(section *sec)
         if(label->type!=LABSYM)
           ierror(0);
         if(label->pc!=sec->pc){
+          taddr oldpc=label->pc;
+          int ndeps;
+
           if(debug)
             printf("moving label %s at line %d from %#lx to %#lx\n",
                    label->name,p->line,
                    (unsigned long)label->pc,(unsigned long)sec->pc);
           done=0;
           label->pc=sec->pc;
+          ndeps=label_moved(label);
+          if(dump_deps)
+            printf("%s pass %d: label %s moved from %#llx to %#llx, "
+                   "%d dependent equates\n",sec->name,pass,label->name,
+                   ULLTADDR(oldpc),ULLTADDR(label->pc),ndeps);
         }
       }
       else if(p->type==VASMDEBUG)
@@ -351,13 +424,6 @@ static int resolve_section(section *sec)
   return pass;
 }
 
-static void bvunite(bvtype *dest,bvtype *src,size_t len)
-{
-  len/=sizeof(bvtype);
-  for(;len>0;len--)
-    *dest++|=*src++;
-}
-
 static void resolve(void)
 {
   section *sec;
@@ -373,6 +439,7 @@ static void resolve(void)
 
   todo=mymalloc(BVSIZE(num_secs));
   memset(todo,~(bvtype)0,BVSIZE(num_secs));
+  eval_cache(1);
 
   do{
     finished=1;
@@ -383,11 +450,13 @@ static void resolve(void)
 	passes = resolve_section(sec);
 	BCLR(todo, sec->idx);
 	if(passes>1){
-	  if(sec->deps)
-	    bvunite(todo, sec->deps, BVSIZE(num_secs));
+	  int i;
+	  for(i=0;i<sec->ndeps;i++)
+	    BSET(todo, sec->deps[i]);
 	}
       }
   }while(!finished);
+  eval_cache(0);
 }
 
 static void assemble(void)
@@ -461,6 +530,10 @@ static void assemble(void)
         }
         else
           db=eval_instruction(p->content.inst,sec,sec->pc);
+#if HAVE_INSTRUCTION_CYCLES
+        if(p->list)
+          p->list->cycles+=instruction_cycles(p->content.inst);
+#endif
         if(pic_check)
           do_pic_check(db->relocs);
         cur_listing=0;
@@ -593,9 +666,9 @@ static void fix_labels(void)
     if (add_uscore && (sym->type==IMPORT || sym->flags&(EXPORT|COMMON|WEAK))) {
       /* imported/exported symbol names receive a leading underscore */
       size_t len = strlen(sym->name) + 1;
-      char *p = myrealloc(sym->name,len+1);
- 
-      memmove(p+1,p,len);
+      char *p = alloc_symname(len+1);
+
+      memcpy(p+1,sym->name,len);
       p[0] = '_';
       sym->name = p;
     }
@@ -683,6 +756,70 @@ static int init_output(char *fmt)
   return 0;
 }
 
+/* Initialize the additional output modules. The main output module,
+   which was initialized before, determines the defaults for assembly. */
+static void init_outmods(void)
+{
+  char *main_copyright=output_copyright,*main_defsecttype=defsecttype;
+  void (*main_write_object)(FILE *,section *,symbol *)=write_object;
+  int (*main_output_args)(char *)=output_args;
+  int main_exec_out=exec_out,main_asciiout=asciiout;
+  int main_secname_attr=secname_attr,main_unnamed_sections=unnamed_sections;
+  int main_bitsperbyte=output_bitsperbyte;
+  int i,j;
+
+  for(i=0;i<num_outmods;i++){
+    struct outmod *om=&outmods[i];
+    if(!strcmp(om->format,output_format))
+      general_error(89,om->format);  /* format selected multiple times */
+    for(j=0;j<i;j++){
+      if(!strcmp(om->format,outmods[j].format))
+        general_error(89,om->format);
+    }
+    asciiout=0;
+    if(!init_output(om->format))
+      general_error(16,om->format);
+    if(!output_bitsperbyte)
+      general_error(15,"output",BITSPERBYTE);
+    om->copyright=output_copyright;
+    om->write_object=write_object;
+    om->output_args=output_args;
+    om->asciiout=asciiout;
+  }
+  output_copyright=main_copyright;
+  write_object=main_write_object;
+  output_args=main_output_args;
+  defsecttype=main_defsecttype;
+  exec_out=main_exec_out;
+  asciiout=main_asciiout;
+  secname_attr=main_secname_attr;
+  unnamed_sections=main_unnamed_sections;
+  output_bitsperbyte=main_bitsperbyte;
+}
+
+/* write the additional output files after the main output file was written,
+   bytes_le is the output endianess in effect before the main module ran */
+static void write_outmods(int bytes_le)
+{
+  int i;
+
+  for(i=0;i<num_outmods&&errors==0;i++){
+    struct outmod *om=&outmods[i];
+    output_bytes_le=bytes_le;  /* may have been changed by another module */
+    fclose(outfile);
+    outfile=NULL;
+    if(!om->name)
+      general_error(90,om->format);  /* no output file name */
+    outname=om->name;
+    asciiout=om->asciiout;
+    outfile=fopen(outname,asciiout?"w":"wb");
+    if(!outfile)
+      general_error(13,outname);
+    else
+      om->write_object(outfile,first_section,first_symbol);
+  }
+}
+
 static int init_main(void)
 {
   int i;
@@ -738,17 +875,11 @@ static void include_main_source(void)
 section *find_section(const char *name,const char *attr)
 {
   section *p;
-  if(secname_attr){
-    for(p=first_section;p;p=p->next){
-      if(!strcmp(name,p->name) && !strcmp(attr,p->attr))
-        return p;
-    }
-  }
-  else{
-    for(p=first_section;p;p=p->next){
-      if(!strcmp(name,p->name))
-        return p;
-    }
+  if(!sechash)
+    return 0;
+  for(p=sechash[hashcode(name)&(sechashsize-1)];p;p=p->hnext){
+    if(!strcmp(name,p->name) && (!secname_attr || !strcmp(attr,p->attr)))
+      return p;
   }
   return 0;
 }
@@ -834,6 +965,7 @@ static int move_label_to_sec(atom *lab,section *ns)
       }
       else
         first_section = os->next;
+      unhash_section(os);
       /* @@@ free section and atoms here */
     }
   }
@@ -949,6 +1081,7 @@ section *new_section(const char *name,const char *attr,int align)
   p=mymalloc(sizeof(*p));
   p->next=0;
   p->deps=0;
+  p->ndeps=p->maxdeps=0;
   p->name=mystrdup(name);
   p->attr=mystrdup(attr);
   p->align=align;
@@ -964,6 +1097,7 @@ section *new_section(const char *name,const char *attr,int align)
     last_section=last_section->next=p;
   else
     first_section=last_section=p;
+  hash_section(p);
   /* transfer saved atoms from intermediate container, when needed */
   p->first=container_section.first;
   p->last=container_section.last;
@@ -1186,10 +1320,21 @@ static void set_defaults(void)
 int main(int argc,char **argv)
 {
   static strbuf buf;
-  int i;
+  int i,output_format_set=0;
+  int curmod=-1,main_asciiout,bytes_le;
   for(i=1;i<argc;i++){
     if(argv[i][0]=='-'&&argv[i][1]=='F'){
-      output_format=argv[i]+2;
+      if(argv[i][2]&&output_format_set){
+        /* each further -F<fmt> selects an additional output module */
+        if(num_outmods>=MAXOUTMODS)
+          general_error(14,argv[i]);
+        outmods[num_outmods].format=argv[i]+2;
+        outmods[num_outmods++].argidx=i;
+      }
+      else{
+        output_format=argv[i]+2;
+        output_format_set=1;
+      }
       argv[i][0]=0;
     }
     if(!strcmp("-quiet",argv[i])){
@@ -1207,6 +1352,9 @@ int main(int argc,char **argv)
     general_error(16,output_format);
   if(!output_bitsperbyte)
     general_error(15,"output",BITSPERBYTE);
+  if(num_outmods)
+    init_outmods();
+  main_asciiout=asciiout;
   if(!init_main())
     general_error(10,"main");
   if(!init_symbol())
@@ -1218,10 +1366,20 @@ int main(int argc,char **argv)
   if(verbose){
     printf("%s\n%s\n%s\n%s\n",
            copyright,cpu_copyright,syntax_copyright,output_copyright);
+    for(i=0;i<num_outmods;i++)
+      printf("%s\n",outmods[i].copyright);
     if(verbose==2)  /* -v */
       leave();
   }
   for(i=1;i<argc;i++){
+    if(curmod+1<num_outmods&&i==outmods[curmod+1].argidx){
+      /* following -o and output options belong to the next output module */
+      if(curmod>=0)
+        outmods[curmod].asciiout=asciiout;
+      else
+        main_asciiout=asciiout;
+      asciiout=outmods[++curmod].asciiout;
+    }
     if(argv[i][0]==0)
       continue;
     if(argv[i][0]!='-'){
@@ -1231,6 +1389,12 @@ int main(int argc,char **argv)
       continue;
     }
     if(!strcmp("-o",argv[i])&&i<argc-1){
+      if(curmod>=0){
+        if(outmods[curmod].name)
+          general_error(28,argv[i]);
+        outmods[curmod].name=argv[++i];
+        continue;
+      }
       if(outname)
         general_error(28,argv[i]);
       outname=argv[++i];
@@ -1375,6 +1539,14 @@ int main(int argc,char **argv)
       unsigned_shift=1;
       continue;
     }
+    if(!strcmp("-shareexp",argv[i])){
+      share_exp=1;
+      continue;
+    }
+    if(!strcmp("-dump-deps",argv[i])){
+      dump_deps=1;
+      continue;
+    }
     if(!strcmp("-w",argv[i])){
       no_warn=1;
       continue;
@@ -1420,7 +1592,11 @@ int main(int argc,char **argv)
       continue;
     if(syntax_args(argv[i]))
       continue;
-    if(output_args(argv[i]))
+    if(curmod>=0){
+      if(outmods[curmod].output_args(argv[i]))
+        continue;
+    }
+    else if(output_args(argv[i]))
       continue;
     if(!strcmp("-esc",argv[i])){
       esc_sequences=1;
@@ -1436,6 +1612,10 @@ int main(int argc,char **argv)
     }
     general_error(14,argv[i]);
   }
+  if(curmod>=0){
+    outmods[curmod].asciiout=asciiout;
+    asciiout=main_asciiout;
+  }
   if(dwarf&&inname==NULL){
     dwarf=0;  /* no DWARF output when input source is from stdin */
     general_error(84);
@@ -1457,6 +1637,13 @@ int main(int argc,char **argv)
   parse();
   end_all_rorg();
   listena=0;
+#if HAVE_CPU_END_PARSE
+  {
+    section *sec;
+    for(sec=first_section;sec;sec=sec->next)
+      cpu_end_parse(sec);
+  }
+#endif
   if(errors==0||produce_listing)
     resolve();
   if(errors==0||produce_listing)
@@ -1491,11 +1678,13 @@ int main(int argc,char **argv)
       /* write the object file */
       if(!outname)
         outname="a.out";
+      bytes_le=output_bytes_le;
       outfile=fopen(outname,asciiout?"w":"wb");
       if(!outfile)
         general_error(13,outname);
       else
         write_object(outfile,first_section,first_symbol);
+      write_outmods(bytes_le);
     }
   }
   leave();
@@ -31,10 +31,10 @@ typedef struct strbuf {
 #define MAXPADSIZE 8  /* max. pattern size to pad alignments */
 
 #include "cpu.h"
+#include "symtab.h"
 #include "symbol.h"
 #include "reloc.h"
 #include "syntax.h"
-#include "symtab.h"
 #include "expr.h"
 #include "atom.h"
 #include "parse.h"
@@ -104,7 +104,9 @@ typedef unsigned int bvtype;
 /* section description */
 struct section {
   struct section *next;
-  bvtype *deps;
+  struct section *hnext;  /* next section in the same name hash bucket */
+  int *deps;              /* sorted indices of dependent sections */
+  int ndeps,maxdeps;
   char *name;
   char *attr;
   atom *first;
@@ -238,6 +240,12 @@ void cpu_opts_init(section *);
 void cpu_opts(void *);
 void print_cpu_opts(FILE *,void *);
 #endif
+#if HAVE_CPU_END_PARSE
+void cpu_end_parse(section *);
+#endif
+#if HAVE_INSTRUCTION_CYCLES
+int instruction_cycles(instruction *);
+#endif
 
 /* provided by syntax.c */
 extern const char *syntax_copyright;